@@ -1,6 +1,16 @@
+newoption {
+	trigger = "pgo",
+	value = "PHASE",
+	description = "Profile-guided optimization of the Monolithic configuration",
+	allowed = {
+		{ "generate", "Build instrumented binaries that record a profile" },
+		{ "use", "Optimize with the recorded profile" },
+	},
+}
+
 solution "DollarGame"
 	
-configurations { "Debug", "Release" }
+configurations { "Debug", "Release", "Monolithic" }
 platforms { "Windows", "Linux" }
 
 startproject "DollarGame"
@@ -17,12 +27,23 @@ project "DollarGameLib"
 	files { 
 		"src/Graph.hpp",
 		"src/Graph.cpp",
+		"src/Laplacian.hpp",
+		"src/Laplacian.cpp",
+		"src/HugePageAllocator.hpp",
+		"src/ThreadPool.hpp",
+		"src/ThreadPool.cpp",
+		"src/CounterRandom.hpp",
+		"src/CounterRandom.cpp",
+		"src/MoveTrace.hpp",
+		"src/MoveTrace.cpp",
+		"src/Timeline.hpp",
 		"src/SolverCommon.hpp",
 		"src/GeneratorCommon.hpp",
 	}
 
 	excludes {
 		"src/DollarGame.cpp",
+		"src/DollarTrace.cpp",
 	}
 
 project "DollarGame"
@@ -43,6 +64,29 @@ project "DollarGame"
 		"src/Generator.cpp",
 		"src/DllUtils.hpp",
 		"src/DllUtils.cpp",
+		"src/TimelineRecorder.hpp",
+		"src/TimelineRecorder.cpp",
+		"src/Statistics.hpp",
+		"src/Statistics.cpp",
+		"src/Regression.hpp",
+		"src/Regression.cpp",
+		"src/ResultStream.hpp",
+		"src/ResultStream.cpp",
+		"src/Checkpoint.hpp",
+		"src/Checkpoint.cpp",
+		"src/GraphReduction.hpp",
+		"src/GraphReduction.cpp",
+		"src/GraphDecomposition.hpp",
+		"src/GraphDecomposition.cpp",
+		"src/BoundedQueue.hpp",
+		"src/GraphPipeline.hpp",
+		"src/GraphPipeline.cpp",
+		"src/AllocationTracker.hpp",
+		"src/AllocationTracker.cpp",
+		"src/GraphHash.hpp",
+		"src/GraphHash.cpp",
+		"src/ResultCache.hpp",
+		"src/ResultCache.cpp",
 	}
 
 	libdirs {
@@ -53,6 +97,15 @@ project "DollarGame"
 		"DollarGameLib",
 	}
 
+	-- Solvers and generators are compiled into the executable and register themselves
+	-- statically, so the whole solve loop can be inlined across what are otherwise DSOs.
+	filter "configurations:Monolithic"
+		files {
+			"src/solvers/*.cpp",
+			"src/generators/*.cpp",
+		}
+		defines "DOLLARGAME_MONOLITHIC"
+
 	filter "platforms:Linux"
 		links {
 			"stdc++fs",
@@ -63,6 +116,35 @@ project "DollarGame"
 			"-pthread",
 		}
 
+project "DollarTrace"
+	location "%{sln.location}/build"
+	kind "ConsoleApp"
+	architecture "x86_64"
+	language "C++"
+	targetdir "%{sln.location}/bin/%{cfg.buildcfg}/"
+	debugdir "%{cfg.targetdir}"
+	flags "FatalWarnings"
+
+	files { 
+		"src/DollarTrace.cpp",
+	}
+
+	libdirs {
+		"%{sln.location}/lib/%{cfg.shortname}",
+	}
+
+	links {
+		"DollarGameLib",
+	}
+
+	filter "platforms:Linux"
+		links {
+			"pthread",
+		}
+		buildoptions {
+			"-pthread",
+		}
+
 group "Solvers"
 
 for _, file in ipairs(os.matchfiles("src/solvers/*.cpp")) do
@@ -76,12 +158,18 @@ for _, file in ipairs(os.matchfiles("src/solvers/*.cpp")) do
 		language "C++"
 		targetname (ident)
 		targetdir "%{sln.location}/bin/%{cfg.buildcfg}/solvers"
+		removeconfigurations "Monolithic"
 		implibdir "%{sln.location}/build/%{cfg.targetname}-%{cfg.shortname}"
 		objdir "%{sln.location}/build/%{cfg.targetname}-%{cfg.shortname}"
 		files { file }
 		libdirs "%{sln.location}/lib/%{cfg.shortname}"
 		links "DollarGameLib"
 		flags "FatalWarnings"
+
+		filter "platforms:Linux"
+			links "pthread"
+			buildoptions "-pthread"
+		filter {}
 end
 
 group "Generators"
@@ -97,6 +185,7 @@ for _, file in ipairs(os.matchfiles("src/generators/*.cpp")) do
 		language "C++"
 		targetname (ident)
 		targetdir "%{sln.location}/bin/%{cfg.buildcfg}/generators"
+		removeconfigurations "Monolithic"
 		implibdir "%{sln.location}/build/%{cfg.targetname}-%{cfg.shortname}"
 		objdir "%{sln.location}/build/%{cfg.targetname}-%{cfg.shortname}"
 		files { file }
@@ -114,6 +203,21 @@ project "*"
 		defines "NDEBUG"
 		symbols "Off"
 		optimize "On"
+	filter "configurations:Monolithic"
+		flags "LinkTimeOptimization"
+	filter { "configurations:Monolithic", "platforms:Linux" }
+		-- Keeps DollarGameLib linkable by archivers without the LTO plugin.
+		buildoptions "-ffat-lto-objects"
+	filter { "configurations:Monolithic", "platforms:Linux", "options:pgo=generate" }
+		buildoptions "-fprofile-generate -fprofile-dir=%{sln.location}/pgo"
+		linkoptions "-fprofile-generate"
+	filter { "configurations:Monolithic", "platforms:Linux", "options:pgo=use" }
+		-- The solvers are multithreaded, so the counters can be slightly inconsistent.
+		buildoptions "-fprofile-use -fprofile-correction -fprofile-dir=%{sln.location}/pgo"
+	filter { "configurations:Monolithic", "platforms:Windows", "options:pgo=generate" }
+		linkoptions "/GENPROFILE"
+	filter { "configurations:Monolithic", "platforms:Windows", "options:pgo=use" }
+		linkoptions "/USEPROFILE"
 	filter "platforms:Windows"
 		buildoptions "/std:c++latest"
 	filter "platforms:Linux"
@@ -0,0 +1,285 @@
+#include "AllocationTracker.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#if _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#include <Psapi.h>
+#include <malloc.h>
+#elif __linux__
+#include <malloc.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+static thread_local AllocationTracker* t_tracker = nullptr;
+
+AllocationTracker::AllocationTracker()
+	: m_allocatedBytes(0)
+	, m_allocationCount(0)
+	, m_liveBytes(0)
+	, m_peakBytes(0)
+{
+}
+
+void AllocationTracker::reset()
+{
+	m_allocatedBytes = 0;
+	m_allocationCount = 0;
+	m_liveBytes = 0;
+	m_peakBytes = 0;
+}
+
+AllocationTracker::Stats AllocationTracker::stats() const
+{
+	Stats stats;
+	stats.allocatedBytes = m_allocatedBytes;
+	stats.allocationCount = m_allocationCount;
+	stats.peakBytes = (uint64_t)m_peakBytes.load();
+	return stats;
+}
+
+void AllocationTracker::allocated(size_t size)
+{
+	m_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+	m_allocationCount.fetch_add(1, std::memory_order_relaxed);
+
+	const int64_t liveBytes = m_liveBytes.fetch_add((int64_t)size, std::memory_order_relaxed) + (int64_t)size;
+	int64_t peakBytes = m_peakBytes.load(std::memory_order_relaxed);
+	while (liveBytes > peakBytes && !m_peakBytes.compare_exchange_weak(peakBytes, liveBytes, std::memory_order_relaxed))
+	{
+	}
+}
+
+void AllocationTracker::freed(size_t size)
+{
+	m_liveBytes.fetch_sub((int64_t)size, std::memory_order_relaxed);
+}
+
+AllocationTracker* AllocationTracker::current()
+{
+	return t_tracker;
+}
+
+AllocationTracker* AllocationTracker::setCurrent(AllocationTracker* tracker)
+{
+	AllocationTracker* previous = t_tracker;
+	t_tracker = tracker;
+	return previous;
+}
+
+size_t currentResidentBytes()
+{
+#if _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	return GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) ? counters.WorkingSetSize : 0;
+#elif __linux__
+	FILE* file = fopen("/proc/self/statm", "r");
+	if (!file)
+	{
+		return 0;
+	}
+
+	unsigned long long totalPages = 0;
+	unsigned long long residentPages = 0;
+	const bool isRead = fscanf(file, "%llu %llu", &totalPages, &residentPages) == 2;
+	fclose(file);
+	return isRead ? (size_t)residentPages * (size_t)sysconf(_SC_PAGESIZE) : 0;
+#endif
+}
+
+size_t peakResidentBytes()
+{
+#if _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	return GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) ? counters.PeakWorkingSetSize : 0;
+#elif __linux__
+	rusage usage;
+	return getrusage(RUSAGE_SELF, &usage) == 0 ? (size_t)usage.ru_maxrss * 1024 : 0;
+#endif
+}
+
+// The replaced operators charge the usable size of every block, which is what the heap
+// really reserved, and is known again when the block is freed.
+static size_t getBlockSize(void* data, size_t alignment)
+{
+#if _WIN32
+	return alignment > 0 ? _aligned_msize(data, alignment, 0) : _msize(data);
+#elif __linux__
+	(void)alignment;
+	return malloc_usable_size(data);
+#endif
+}
+
+static void* allocate(size_t size, size_t alignment)
+{
+	size = size > 0 ? size : 1;
+	while (true)
+	{
+		void* data;
+#if _WIN32
+		data = alignment > 0 ? _aligned_malloc(size, alignment) : malloc(size);
+#elif __linux__
+		if (alignment == 0)
+		{
+			data = malloc(size);
+		}
+		else if (posix_memalign(&data, alignment, size) != 0)
+		{
+			data = nullptr;
+		}
+#endif
+
+		if (data)
+		{
+			if (AllocationTracker* tracker = t_tracker)
+			{
+				tracker->allocated(getBlockSize(data, alignment));
+			}
+			return data;
+		}
+
+		const std::new_handler handler = std::get_new_handler();
+		if (!handler)
+		{
+			return nullptr;
+		}
+		handler();
+	}
+}
+
+static void* allocateOrThrow(size_t size, size_t alignment)
+{
+	void* data = allocate(size, alignment);
+	if (!data)
+	{
+		throw std::bad_alloc();
+	}
+	return data;
+}
+
+static void deallocate(void* data, size_t alignment)
+{
+	if (!data)
+	{
+		return;
+	}
+
+	if (AllocationTracker* tracker = t_tracker)
+	{
+		tracker->freed(getBlockSize(data, alignment));
+	}
+
+#if _WIN32
+	if (alignment > 0)
+	{
+		_aligned_free(data);
+		return;
+	}
+#endif
+	free(data);
+}
+
+void* operator new(size_t size)
+{
+	return allocateOrThrow(size, 0);
+}
+
+void* operator new[](size_t size)
+{
+	return allocateOrThrow(size, 0);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return allocate(size, 0);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return allocate(size, 0);
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+	return allocateOrThrow(size, (size_t)alignment);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+	return allocateOrThrow(size, (size_t)alignment);
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return allocate(size, (size_t)alignment);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return allocate(size, (size_t)alignment);
+}
+
+void operator delete(void* data) noexcept
+{
+	deallocate(data, 0);
+}
+
+void operator delete[](void* data) noexcept
+{
+	deallocate(data, 0);
+}
+
+void operator delete(void* data, size_t) noexcept
+{
+	deallocate(data, 0);
+}
+
+void operator delete[](void* data, size_t) noexcept
+{
+	deallocate(data, 0);
+}
+
+void operator delete(void* data, const std::nothrow_t&) noexcept
+{
+	deallocate(data, 0);
+}
+
+void operator delete[](void* data, const std::nothrow_t&) noexcept
+{
+	deallocate(data, 0);
+}
+
+void operator delete(void* data, std::align_val_t alignment) noexcept
+{
+	deallocate(data, (size_t)alignment);
+}
+
+void operator delete[](void* data, std::align_val_t alignment) noexcept
+{
+	deallocate(data, (size_t)alignment);
+}
+
+void operator delete(void* data, size_t, std::align_val_t alignment) noexcept
+{
+	deallocate(data, (size_t)alignment);
+}
+
+void operator delete[](void* data, size_t, std::align_val_t alignment) noexcept
+{
+	deallocate(data, (size_t)alignment);
+}
+
+void operator delete(void* data, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	deallocate(data, (size_t)alignment);
+}
+
+void operator delete[](void* data, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	deallocate(data, (size_t)alignment);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <cinttypes>
+#include <cstddef>
+
+// Counts the heap allocations of the threads it is installed on, for --track-memory. The
+// global operator new and delete are replaced so that every allocation is charged to the
+// tracker of the allocating thread, and every free to the tracker of the freeing thread.
+// The live bytes of a tracker, and so its peak, are exact as long as its threads free what
+// they allocate. On threads without a tracker, an allocation costs a thread-local null check.
+//
+// On Linux the solver and generator modules allocate through the replaced operators too.
+// On Windows every DLL has its own heap, so only the harness is tracked.
+class AllocationTracker final
+{
+public:
+	struct Stats
+	{
+		uint64_t allocatedBytes = 0;
+		uint64_t allocationCount = 0;
+		// Highest live bytes since the last reset, relative to what was live then.
+		uint64_t peakBytes = 0;
+	};
+
+private:
+	std::atomic<uint64_t> m_allocatedBytes;
+	std::atomic<uint64_t> m_allocationCount;
+	std::atomic<int64_t> m_liveBytes;
+	std::atomic<int64_t> m_peakBytes;
+
+public:
+	AllocationTracker();
+	AllocationTracker(const AllocationTracker&) = delete;
+
+	void reset();
+	Stats stats() const;
+
+	void allocated(size_t size);
+	void freed(size_t size);
+
+	// The tracker of the calling thread, or null.
+	static AllocationTracker* current();
+
+	// Installs the tracker, or none, on the calling thread. Returns the previous one.
+	static AllocationTracker* setCurrent(AllocationTracker* tracker);
+
+	// Installs a tracker on the calling thread until the end of the scope.
+	class Scope final
+	{
+	private:
+		AllocationTracker* m_previous;
+
+	public:
+		explicit Scope(AllocationTracker* tracker)
+			: m_previous(setCurrent(tracker))
+		{
+		}
+
+		Scope(const Scope&) = delete;
+
+		~Scope()
+		{
+			setCurrent(m_previous);
+		}
+	};
+};
+
+// Resident set size of the process, now and at its highest, in bytes. 0 where unknown.
+size_t currentResidentBytes();
+size_t peakResidentBytes();
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+// Blocking queue of at most a fixed number of items, for handing work from one thread to
+// another with backpressure: push waits while the queue is full, pop while it's empty.
+// Closing the queue wakes everybody up, after which push fails and pop drains what is left.
+template<typename T>
+class BoundedQueue final
+{
+private:
+	std::mutex m_mutex;
+	std::condition_variable m_notEmpty;
+	std::condition_variable m_notFull;
+	std::deque<T> m_items;
+	size_t m_capacity;
+	bool m_closed;
+
+public:
+	explicit BoundedQueue(size_t capacity)
+		: m_capacity(capacity)
+		, m_closed(false)
+	{
+	}
+
+	BoundedQueue(const BoundedQueue&) = delete;
+
+	// Returns false, dropping the item, if the queue was closed.
+	bool push(T item)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_notFull.wait(lock, [this] { return m_items.size() < m_capacity || m_closed; });
+		if (m_closed)
+		{
+			return false;
+		}
+
+		m_items.push_back(std::move(item));
+		m_notEmpty.notify_one();
+		return true;
+	}
+
+	// Returns false once the queue was closed and is empty.
+	bool pop(T& outItem)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_notEmpty.wait(lock, [this] { return !m_items.empty() || m_closed; });
+		if (m_items.empty())
+		{
+			return false;
+		}
+
+		outItem = std::move(m_items.front());
+		m_items.pop_front();
+		m_notFull.notify_one();
+		return true;
+	}
+
+	void close()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_closed = true;
+		m_notEmpty.notify_all();
+		m_notFull.notify_all();
+	}
+};
@@ -0,0 +1,246 @@
+#include "Checkpoint.hpp"
+
+#include <experimental/filesystem>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <stdexcept>
+
+static const char* CheckpointHeader = "# DollarGame checkpoint 2";
+
+void CheckpointCell::addTrial(size_t moveCount, double seconds)
+{
+	const double secondsDelta = seconds - averageSeconds();
+
+	addCachedTrial(moveCount);
+	++timedIterations;
+	totalSeconds += seconds;
+
+	secondsSquaredDeviations += secondsDelta * (seconds - averageSeconds());
+}
+
+void CheckpointCell::addCachedTrial(size_t moveCount)
+{
+	const double movesDelta = (double)moveCount - averageMoves();
+
+	++completedIterations;
+	totalMoves += moveCount;
+
+	movesSquaredDeviations += movesDelta * ((double)moveCount - averageMoves());
+}
+
+void CheckpointCell::merge(const CheckpointCell& other)
+{
+	// Chan et al.: the squared deviations of both halves plus those of their means.
+	const auto combinedSquaredDeviations = [] (size_t count, size_t otherCount, double delta) {
+		if (count == 0 || otherCount == 0)
+		{
+			return 0.0;
+		}
+		return delta * delta * (double)count * (double)otherCount / (double)(count + otherCount);
+	};
+
+	movesSquaredDeviations += other.movesSquaredDeviations + combinedSquaredDeviations(completedIterations, other.completedIterations, other.averageMoves() - averageMoves());
+	secondsSquaredDeviations += other.secondsSquaredDeviations + combinedSquaredDeviations(timedIterations, other.timedIterations, other.averageSeconds() - averageSeconds());
+	completedIterations += other.completedIterations;
+	timedIterations += other.timedIterations;
+	totalMoves += other.totalMoves;
+	totalSeconds += other.totalSeconds;
+}
+
+Checkpoint::Checkpoint(const std::string& filename, const std::string& solver, size_t iterations)
+	: m_filename(filename)
+	, m_solver(solver)
+	, m_iterations(iterations)
+	, m_isSeeded(false)
+{
+}
+
+bool Checkpoint::load()
+{
+	std::ifstream is(m_filename);
+	if (!is)
+	{
+		return false;
+	}
+
+	std::string line;
+	if (!std::getline(is, line) || line != CheckpointHeader)
+	{
+		throw std::runtime_error(m_filename + " is not a checkpoint");
+	}
+
+	// Sweeps without a seed leave out the seed and shard lines.
+	const bool acceptsAny = m_solver.empty();
+	bool isSeeded = false;
+	Shard shard;
+	Sweep sweep;
+
+	while (std::getline(is, line))
+	{
+		std::istringstream ls(line);
+		std::string key;
+		ls >> key;
+
+		if (key == "solver")
+		{
+			std::string solver;
+			ls >> solver;
+			if (acceptsAny)
+			{
+				m_solver = solver;
+			}
+			else if (solver != m_solver)
+			{
+				throw std::runtime_error("Checkpoint " + m_filename + " belongs to solver " + solver);
+			}
+		}
+		else if (key == "iterations")
+		{
+			size_t iterations = 0;
+			ls >> iterations;
+			if (acceptsAny)
+			{
+				m_iterations = iterations;
+			}
+			else if (iterations != m_iterations)
+			{
+				throw std::runtime_error("Checkpoint " + m_filename + " was written with " + std::to_string(iterations) + " iterations");
+			}
+		}
+		else if (key == "seed")
+		{
+			isSeeded = true;
+			ls >> shard.seed;
+		}
+		else if (key == "shard")
+		{
+			ls >> shard.index >> shard.count;
+			if (!ls || shard.count == 0 || shard.index >= shard.count)
+			{
+				throw std::runtime_error("Malformed checkpoint line: " + line);
+			}
+		}
+		else if (key == "generators")
+		{
+			std::string generator;
+			while (ls >> generator)
+			{
+				sweep.generators.push_back(generator);
+			}
+		}
+		else if (key == "sizes")
+		{
+			size_t graphSize = 0;
+			while (ls >> graphSize)
+			{
+				sweep.graphSizes.push_back(graphSize);
+			}
+		}
+		else if (key == "values")
+		{
+			ls >> sweep.minValue >> sweep.maxValue;
+		}
+		else if (key == "reduce")
+		{
+			ls >> sweep.reduce;
+		}
+		else if (key == "decompose")
+		{
+			ls >> sweep.decompose;
+		}
+		else if (key == "random")
+		{
+			std::getline(ls >> std::ws, m_randomState);
+		}
+		else if (key == "cell")
+		{
+			std::string generator;
+			size_t graphSize = 0;
+			CheckpointCell cell;
+			ls >> generator >> graphSize >> cell.completedIterations >> cell.totalMoves >> cell.totalSeconds
+				>> cell.movesSquaredDeviations >> cell.secondsSquaredDeviations >> cell.timedIterations;
+			if (!ls)
+			{
+				throw std::runtime_error("Malformed checkpoint line: " + line);
+			}
+			m_cells[std::make_pair(generator, graphSize)] = cell;
+		}
+	}
+
+	if (acceptsAny)
+	{
+		m_isSeeded = isSeeded;
+		m_shard = shard;
+		m_sweep = sweep;
+	}
+	else if (isSeeded != m_isSeeded || !(shard == m_shard))
+	{
+		throw std::runtime_error("Checkpoint " + m_filename + " was written with another --seed or --shard");
+	}
+	else if (!(sweep == m_sweep))
+	{
+		throw std::runtime_error("Checkpoint " + m_filename + " was written with other --generators, --graph-sizes, --value-range, --reduce or --decompose");
+	}
+
+	return true;
+}
+
+void Checkpoint::save() const
+{
+	const std::string tempFilename = m_filename + ".tmp";
+	{
+		std::ofstream os(tempFilename);
+		if (!os)
+		{
+			throw std::runtime_error("Failed to write checkpoint " + tempFilename);
+		}
+
+		os << std::setprecision(17);
+		os << CheckpointHeader << '\n';
+		os << "solver " << m_solver << '\n';
+		os << "iterations " << m_iterations << '\n';
+		if (m_isSeeded)
+		{
+			os << "seed " << m_shard.seed << '\n';
+			os << "shard " << m_shard.index << ' ' << m_shard.count << '\n';
+		}
+		os << "generators";
+		for (const std::string& generator : m_sweep.generators)
+		{
+			os << ' ' << generator;
+		}
+		os << '\n';
+		os << "sizes";
+		for (size_t graphSize : m_sweep.graphSizes)
+		{
+			os << ' ' << graphSize;
+		}
+		os << '\n';
+		os << "values " << m_sweep.minValue << ' ' << m_sweep.maxValue << '\n';
+		os << "reduce " << m_sweep.reduce << '\n';
+		os << "decompose " << m_sweep.decompose << '\n';
+		os << "random " << m_randomState << '\n';
+		for (const auto& cell : m_cells)
+		{
+			os << "cell "
+				<< cell.first.first << ' '
+				<< cell.first.second << ' '
+				<< cell.second.completedIterations << ' '
+				<< cell.second.totalMoves << ' '
+				<< cell.second.totalSeconds << ' '
+				<< cell.second.movesSquaredDeviations << ' '
+				<< cell.second.secondsSquaredDeviations << ' '
+				<< cell.second.timedIterations << '\n';
+		}
+
+		// A full disk only shows once the buffer is written out, and a partial checkpoint
+		// must never replace a complete one.
+		if (!os.flush())
+		{
+			throw std::runtime_error("Failed to write checkpoint " + tempFilename);
+		}
+	}
+
+	std::experimental::filesystem::rename(tempFilename, m_filename);
+}
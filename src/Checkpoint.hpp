@@ -0,0 +1,175 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cinttypes>
+
+// Finished work of one (generator, size) cell of a sweep. Besides the totals, the sums of
+// squared deviations from the mean are kept up to date with Welford's method, so the
+// confidence interval of a cell is known after every trial.
+//
+// Trials taken from the result cache only count towards the moves. Their seconds were
+// measured by another run, so the seconds are over the timed iterations alone.
+struct CheckpointCell
+{
+	size_t completedIterations = 0;
+	size_t timedIterations = 0;
+	uint64_t totalMoves = 0;
+	double totalSeconds = 0.0;
+	double movesSquaredDeviations = 0.0;
+	double secondsSquaredDeviations = 0.0;
+
+	void addTrial(size_t moveCount, double seconds);
+	void addCachedTrial(size_t moveCount);
+
+	// Adds the trials of another cell, as if they had been added one by one.
+	void merge(const CheckpointCell& other);
+
+	double averageMoves() const
+	{
+		return completedIterations > 0 ? (double)totalMoves / (double)completedIterations : 0.0;
+	}
+
+	double averageSeconds() const
+	{
+		return timedIterations > 0 ? totalSeconds / (double)timedIterations : 0.0;
+	}
+
+	// Unbiased sample variances.
+	double movesVariance() const
+	{
+		return completedIterations > 1 ? movesSquaredDeviations / (double)(completedIterations - 1) : 0.0;
+	}
+
+	double secondsVariance() const
+	{
+		return timedIterations > 1 ? secondsSquaredDeviations / (double)(timedIterations - 1) : 0.0;
+	}
+};
+
+// Progress of a benchmark sweep: the finished iterations and running totals of every cell,
+// plus the random generator state after the last finished iteration, so a resumed sweep
+// continues with exactly the graphs the interrupted one would have generated.
+//
+// Shards of a sweep with a --seed write their totals in the same format, along with the
+// seed and the shard, so that --merge can add them up.
+//
+// The generators, sizes, value range and the way the graphs were solved are recorded too,
+// as the totals of a cell only add up over trials of the same sweep.
+class Checkpoint final
+{
+public:
+	struct Shard
+	{
+		uint64_t seed = 0;
+		size_t index = 0;
+		size_t count = 1;
+
+		bool operator==(const Shard& other) const
+		{
+			return seed == other.seed && index == other.index && count == other.count;
+		}
+	};
+
+	struct Sweep
+	{
+		std::vector<std::string> generators;
+		std::vector<size_t> graphSizes;
+		int64_t minValue = 0;
+		int64_t maxValue = 0;
+		bool reduce = false;
+		bool decompose = false;
+
+		bool operator==(const Sweep& other) const
+		{
+			return generators == other.generators && graphSizes == other.graphSizes
+				&& minValue == other.minValue && maxValue == other.maxValue
+				&& reduce == other.reduce && decompose == other.decompose;
+		}
+	};
+
+	using Cells = std::map<std::pair<std::string, size_t>, CheckpointCell>;
+
+private:
+	std::string m_filename;
+	std::string m_solver;
+	size_t m_iterations;
+	std::string m_randomState;
+	bool m_isSeeded;
+	Shard m_shard;
+	Sweep m_sweep;
+	Cells m_cells;
+
+public:
+	// An empty solver accepts any checkpoint and takes its solver, iteration count, shard
+	// and sweep.
+	Checkpoint(const std::string& filename, const std::string& solver, size_t iterations);
+	Checkpoint(const Checkpoint&) = delete;
+
+	// Returns false if there is no checkpoint file yet. Throws if the file is malformed or
+	// was written by a sweep with another solver, iteration count, seed, shard, generators,
+	// sizes, value range, --reduce or --decompose.
+	bool load();
+
+	// Replaces the checkpoint file. The file is written next to the old one and then
+	// renamed over it, so a crash during the save never loses the previous checkpoint.
+	// Throws, and leaves the previous checkpoint alone, if the file can't be written.
+	void save() const;
+
+	CheckpointCell& cell(const std::string& generator, size_t graphSize)
+	{
+		return m_cells[std::make_pair(generator, graphSize)];
+	}
+
+	const Cells& cells() const
+	{
+		return m_cells;
+	}
+
+	const std::string& solver() const
+	{
+		return m_solver;
+	}
+
+	size_t iterations() const
+	{
+		return m_iterations;
+	}
+
+	bool isSeeded() const
+	{
+		return m_isSeeded;
+	}
+
+	const Shard& shard() const
+	{
+		return m_shard;
+	}
+
+	void setShard(const Shard& shard)
+	{
+		m_isSeeded = true;
+		m_shard = shard;
+	}
+
+	const Sweep& sweep() const
+	{
+		return m_sweep;
+	}
+
+	void setSweep(const Sweep& sweep)
+	{
+		m_sweep = sweep;
+	}
+
+	const std::string& randomState() const
+	{
+		return m_randomState;
+	}
+
+	void setRandomState(const std::string& randomState)
+	{
+		m_randomState = randomState;
+	}
+};
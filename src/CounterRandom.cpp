@@ -0,0 +1,134 @@
+#include "CounterRandom.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+
+static constexpr uint32_t PhiloxM0 = 0xd2511f53;
+static constexpr uint32_t PhiloxM1 = 0xcd9e8d57;
+static constexpr uint32_t PhiloxW0 = 0x9e3779b9;
+static constexpr uint32_t PhiloxW1 = 0xbb67ae85;
+
+// Numbers per task of a bulk fill. A multiple of the batch, so that every task starts on a
+// batch of its own.
+static constexpr size_t FillChunkSize = 1 << 16;
+
+// The blocks from firstBlock on, each lane a block. The counter is the 64-bit block
+// number, the stream and a zero word.
+template<size_t Lanes>
+static inline void philox(const uint32_t* key, uint64_t firstBlock, uint32_t stream, uint32_t* out)
+{
+	uint32_t c0[Lanes];
+	uint32_t c1[Lanes];
+	uint32_t c2[Lanes];
+	uint32_t c3[Lanes];
+	for (size_t lane = 0; lane < Lanes; ++lane)
+	{
+		c0[lane] = (uint32_t)(firstBlock + lane);
+		c1[lane] = (uint32_t)((firstBlock + lane) >> 32);
+		c2[lane] = stream;
+		c3[lane] = 0;
+	}
+
+	uint32_t k0 = key[0];
+	uint32_t k1 = key[1];
+	for (int round = 0; round < 10; ++round)
+	{
+		for (size_t lane = 0; lane < Lanes; ++lane)
+		{
+			const uint64_t product0 = (uint64_t)PhiloxM0 * c0[lane];
+			const uint64_t product1 = (uint64_t)PhiloxM1 * c2[lane];
+			const uint32_t next0 = (uint32_t)(product1 >> 32) ^ c1[lane] ^ k0;
+			const uint32_t next2 = (uint32_t)(product0 >> 32) ^ c3[lane] ^ k1;
+			c1[lane] = (uint32_t)product1;
+			c3[lane] = (uint32_t)product0;
+			c0[lane] = next0;
+			c2[lane] = next2;
+		}
+		k0 += PhiloxW0;
+		k1 += PhiloxW1;
+	}
+
+	for (size_t lane = 0; lane < Lanes; ++lane)
+	{
+		out[lane * 4 + 0] = c0[lane];
+		out[lane * 4 + 1] = c1[lane];
+		out[lane * 4 + 2] = c2[lane];
+		out[lane * 4 + 3] = c3[lane];
+	}
+}
+
+CounterRandom::CounterRandom(uint64_t key)
+{
+	m_key[0] = (uint32_t)key;
+	m_key[1] = (uint32_t)(key >> 32);
+}
+
+void CounterRandom::generateBatch(uint64_t firstBlock, uint32_t stream, uint32_t* out) const
+{
+	philox<BatchSize>(m_key, firstBlock, stream, out);
+}
+
+void CounterRandom::generateBlock(uint64_t block, uint32_t stream, uint32_t* out) const
+{
+	philox<1>(m_key, block, stream, out);
+}
+
+void CounterRandom::fillBounded(uint32_t* out, size_t count, uint32_t first, uint32_t range, ThreadPool* threadPool) const
+{
+	// Lemire's multiply-shift, with the rejections that make it unbiased. A number is
+	// rejected with a chance of range in 2^32 at most, so rejections take a block each.
+	const uint32_t threshold = range > 0 ? (0u - range) % range : 0;
+	const auto bound = [this, range, threshold] (uint32_t bits, size_t index) {
+		uint64_t product = (uint64_t)bits * range;
+		for (uint32_t stream = 1; (uint32_t)product < threshold; ++stream)
+		{
+			uint32_t block[4];
+			generateBlock(index / 4, stream, block);
+			product = (uint64_t)block[index % 4] * range;
+		}
+		return (uint32_t)(product >> 32);
+	};
+
+	const auto fillChunk = [this, out, count, first, range, &bound] (size_t chunkIt) {
+		const size_t chunkBegin = chunkIt * FillChunkSize;
+		const size_t chunkEnd = std::min(count, chunkBegin + FillChunkSize);
+
+		uint32_t bits[BatchSize * 4];
+		for (size_t batchBegin = chunkBegin; batchBegin < chunkEnd; batchBegin += BatchSize * 4)
+		{
+			generateBatch(batchBegin / 4, 0, bits);
+
+			const size_t batchCount = std::min(BatchSize * 4, chunkEnd - batchBegin);
+			for (size_t bitsIt = 0; bitsIt < batchCount; ++bitsIt)
+			{
+				out[batchBegin + bitsIt] = first + (range > 0 ? bound(bits[bitsIt], batchBegin + bitsIt) : bits[bitsIt]);
+			}
+		}
+	};
+
+	const size_t chunkCount = (count + FillChunkSize - 1) / FillChunkSize;
+	if (threadPool && chunkCount > 1)
+	{
+		threadPool->run(chunkCount, fillChunk);
+	}
+	else
+	{
+		for (size_t chunkIt = 0; chunkIt < chunkCount; ++chunkIt)
+		{
+			fillChunk(chunkIt);
+		}
+	}
+}
+
+void CounterRandom::fillUniformValues(Range<NodeValue> values, NodeValue minValue, NodeValue maxValue, ThreadPool* threadPool) const
+{
+	static_assert(sizeof(NodeValue) == sizeof(uint32_t), "The values are filled as their 32-bit patterns.");
+
+	// Two's complement, so the values are the minimum plus an offset, wrapping around.
+	fillBounded(reinterpret_cast<uint32_t*>(values.data()), values.size(), (uint32_t)minValue, (uint32_t)maxValue - (uint32_t)minValue + 1, threadPool);
+}
+
+void CounterRandom::fillUniformHandles(Range<NodeHandle> handles, NodeHandle minHandle, NodeHandle maxHandle, ThreadPool* threadPool) const
+{
+	fillBounded(handles.data(), handles.size(), minHandle, maxHandle - minHandle + 1, threadPool);
+}
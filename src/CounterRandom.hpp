@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Graph.hpp"
+
+class ThreadPool;
+
+// SplitMix64 finalizer of Steele et al.: scatters consecutive or otherwise structured inputs
+// over all 64-bit values, for keys and seeds derived from indices.
+inline uint64_t splitMix64(uint64_t value)
+{
+	value += 0x9e3779b97f4a7c15ull;
+	value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+	value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+	return value ^ (value >> 31);
+}
+
+// Philox4x32-10, the counter-based generator of Salmon et al., "Parallel Random Numbers: As
+// Easy as 1, 2, 3". Block n of the stream is four 32-bit words that are a function of n and
+// the key alone, so any part of the stream can be generated without the parts before it.
+// The bulk fills split the stream into chunks for the thread pool, and come out the same
+// for any number of threads. Blocks are generated a batch at a time in lockstep, which the
+// compiler vectorizes.
+class CounterRandom final
+{
+public:
+	// Blocks per batch.
+	static constexpr size_t BatchSize = 16;
+
+private:
+	uint32_t m_key[2];
+
+	// Fills out with count numbers uniformly distributed in [first, first + range), wrapping
+	// around, or over all 32-bit numbers if range is 0. Number i of the output only depends
+	// on i and the key.
+	void fillBounded(uint32_t* out, size_t count, uint32_t first, uint32_t range, ThreadPool* threadPool) const;
+
+public:
+	explicit CounterRandom(uint64_t key);
+
+	// The BatchSize blocks starting from firstBlock, word by word.
+	void generateBatch(uint64_t firstBlock, uint32_t stream, uint32_t* out) const;
+
+	// The single block at the given counter.
+	void generateBlock(uint64_t block, uint32_t stream, uint32_t* out) const;
+
+	// Unbiased: numbers that would make the range uneven are drawn again, from another
+	// stream at the same counter.
+	void fillUniformValues(Range<NodeValue> values, NodeValue minValue, NodeValue maxValue, ThreadPool* threadPool = nullptr) const;
+	void fillUniformHandles(Range<NodeHandle> handles, NodeHandle minHandle, NodeHandle maxHandle, ThreadPool* threadPool = nullptr) const;
+};
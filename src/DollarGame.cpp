@@ -1,111 +1,772 @@
 ﻿#include "Graph.hpp"
 #include "Solver.hpp"
 #include "Generator.hpp"
+#include "MoveTrace.hpp"
+#include "TimelineRecorder.hpp"
+#include "Regression.hpp"
+#include "ResultStream.hpp"
+#include "Checkpoint.hpp"
+#include "Statistics.hpp"
+#include "ThreadPool.hpp"
+#include "GraphReduction.hpp"
+#include "GraphDecomposition.hpp"
+#include "GraphPipeline.hpp"
+#include "Laplacian.hpp"
+#include "AllocationTracker.hpp"
+#include "GraphHash.hpp"
+#include "ResultCache.hpp"
+#include "CounterRandom.hpp"
 
 #include <iostream>
 #include <random>
 #include <fstream>
 #include <experimental/filesystem>
 #include <thread>
-#include <future>
+#include <mutex>
+#include <condition_variable>
 #include <iomanip>
 #include <cstring>
 #include <map>
+#include <numeric>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <sstream>
 
 #if _WIN32
 #define NOMINMAX
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
 #elif __linux__
+#include <pthread.h>
 #include <unistd.h>
 #endif
 
-static std::experimental::filesystem::path getExecutableDir()
+static std::string getExecutablePath()
 {
 #if _WIN32
 	char buf[MAX_PATH + 1];
 	GetModuleFileNameA(NULL, buf, sizeof(buf));
-	const auto lastSlashPos = std::string(buf).find_last_of("\\/");
-	return std::string(buf).substr(0, lastSlashPos);
+	return buf;
 #elif __linux__
 	char buf[256];
-	readlink("/proc/self/exe", buf, sizeof(buf));
-	const auto lastSlashPos = std::string(buf).find_last_of("\\/");
-	return std::string(buf).substr(0, lastSlashPos);
+	const ssize_t length = readlink("/proc/self/exe", buf, sizeof(buf) - 1);
+	buf[length > 0 ? length : 0] = '\0';
+	return buf;
+#endif
+}
+
+// Keeps the calling thread on cores [firstCore, firstCore + coreCount).
+static void pinCurrentThread(size_t firstCore, size_t coreCount)
+{
+#if _WIN32
+	DWORD_PTR mask = 0;
+	for (size_t core = firstCore; core < firstCore + coreCount; ++core)
+	{
+		mask |= DWORD_PTR(1) << core;
+	}
+	SetThreadAffinityMask(GetCurrentThread(), mask);
+#elif __linux__
+	cpu_set_t cpus;
+	CPU_ZERO(&cpus);
+	for (size_t core = firstCore; core < firstCore + coreCount; ++core)
+	{
+		CPU_SET(core, &cpus);
+	}
+	pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
 #endif
 }
 
-static Graph generateGraph(const GraphGenerator& generator, std::mt19937& random, size_t size)
+#if !DOLLARGAME_MONOLITHIC
+static std::experimental::filesystem::path getExecutableDir()
+{
+	const std::string path = getExecutablePath();
+	const auto lastSlashPos = path.find_last_of("\\/");
+	return path.substr(0, lastSlashPos);
+}
+#endif
+
+struct SolveResult
 {
-	while (true)
+	size_t moveCount = 0;
+	double solveSeconds = 0.0;
+
+	// With --reduce or --decompose, whether the expanded or merged solution left debt for
+	// the solver to finish.
+	bool finishedOnOriginal = false;
+
+	// With --track-memory, what the solve allocated, the copy of the graph included, and the
+	// resident set size of the process right after it.
+	AllocationTracker::Stats allocations;
+	size_t residentBytes = 0;
+};
+
+// Where the solver threads of a --portfolio race report that they finished, so that the
+// harness can wait for the first of them to succeed rather than for each in turn.
+class SolverRace final
+{
+private:
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::chrono::steady_clock::time_point m_start;
+	std::chrono::steady_clock::time_point m_finish;
+	size_t m_runnerCount;
+	size_t m_finishedCount;
+	size_t m_winner;
+
+public:
+	SolverRace()
+		: m_runnerCount(0)
+		, m_finishedCount(0)
+		, m_winner(SIZE_MAX)
 	{
-		Graph graph;
-		GeneratorContext ctx(graph, random);
+	}
 
-		GeneratorParams params(size, -2, 3);
+	SolverRace(const SolverRace&) = delete;
+
+	// Starts the clock for a race of the given number of runners.
+	void start(size_t runnerCount)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_start = std::chrono::steady_clock::now();
+		m_runnerCount = runnerCount;
+		m_finishedCount = 0;
+		m_winner = SIZE_MAX;
+	}
 
-		generator.generate(ctx, params);
+	// Called by the solver threads when their solve ends, whether it succeeded or not.
+	void finish(size_t runner, bool succeeded)
+	{
+		const auto now = std::chrono::steady_clock::now();
 
-		// Make sure the graph is solvable and unsolved.
-		if (!graph.isSolvable())
+		std::lock_guard<std::mutex> lock(m_mutex);
+		++m_finishedCount;
+		if (succeeded && m_winner == SIZE_MAX)
 		{
-			//std::cout << "Unsolvable\n";
-			continue;
+			m_winner = runner;
+			m_finish = now;
 		}
-		else if (graph.isSolved())
+		m_condition.notify_all();
+	}
+
+	// Waits until a runner succeeds, every runner failed, or a second has passed. Returns the
+	// runner that succeeded first, SIZE_MAX if none did.
+	size_t wait()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_condition.wait_until(lock, m_start + std::chrono::milliseconds(1000), [this] {
+			return m_winner != SIZE_MAX || m_finishedCount == m_runnerCount;
+		});
+		return m_winner;
+	}
+
+	// Time from start to the success of the winner, the copies of the graph included.
+	double latencySeconds()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return std::chrono::duration<double>(m_finish - m_start).count();
+	}
+};
+
+// Runs the solves of one worker on a thread that lives as long as the worker, so that a
+// trial doesn't have to start a thread. The solver context is reused too, which keeps the
+// trials of a sweep from allocating once the buffers have grown to the largest graph. The
+// thread pool is the solver's, for parallel solvers and batched moves.
+//
+// Given a first core, the solver thread and its pool are kept on as many cores as the pool
+// has threads, from that one on, so that solvers running side by side don't compete.
+//
+// With --track-memory, the solver thread and the workers of its pool charge everything they
+// allocate to the tracker of the solver thread, and the context starts every solve with
+// empty buffers, so that every solve reports the memory it needs on its own.
+class SolverThread final
+{
+private:
+	AllocationTracker m_allocations;
+	const bool m_tracksMemory;
+	const size_t m_firstCore;
+	const size_t m_coreCount;
+	SolverContext m_ctx;
+	ThreadPool m_threadPool;
+	std::unique_ptr<MoveTraceWriter> m_trace;
+	const GraphSolver* m_solver;
+	const GraphSolver* m_namedSolver;
+	const std::vector<int64_t>* m_firings;
+	std::chrono::steady_clock::time_point m_deadline;
+	SolverRace* m_race;
+	size_t m_runner;
+
+	// With --decompose, one context per block, solved in parallel on the thread pool,
+	// largest blocks first.
+	const GraphDecomposition* m_decomposition;
+	std::vector<std::unique_ptr<SolverContext>> m_blockContexts;
+	std::vector<size_t> m_blockOrder;
+
+	std::thread m_thread;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	bool m_busy;
+	bool m_exiting;
+
+	bool m_succeeded;
+	bool m_finishedOnOriginal;
+	std::chrono::steady_clock::duration m_solveTime;
+
+	void applyFirings(const std::vector<int64_t>& firings)
+	{
+		for (NodeHandle node = 0; node < firings.size() && m_ctx.moveCount() <= m_ctx.moveLimit(); ++node)
 		{
-			//std::cout << "Already solved\n";
-			continue;
+			for (int64_t firing = 0; firing < firings[node]; ++firing)
+			{
+				m_ctx.registerMove<Move::Give>(node);
+			}
+
+			for (int64_t firing = 0; firing > firings[node]; --firing)
+			{
+				m_ctx.registerMove<Move::Take>(node);
+			}
 		}
+	}
 
-		//std::cout << "Done\n";
-		return graph;
-	};
-}
+	// The block solvers get no thread pool, as its tasks can't run tasks of their own.
+	bool solveBlocks()
+	{
+		std::atomic<bool> failed(false);
+		m_threadPool.run(m_blockOrder.size(), [this, &failed] (size_t taskIt) {
+			SolverContext& ctx = *m_blockContexts[m_blockOrder[taskIt]];
+			if (ctx.isSolved())
+			{
+				return;
+			}
 
-static bool trySolve(const Graph& graph, const GraphSolver& solver, std::vector<Move>& outMoves, size_t moveLimit)
-{
-	SolverContext ctx(graph, outMoves, moveLimit);
+			try
+			{
+				m_solver->solve(ctx);
+				if (ctx.wasStopped())
+				{
+					failed = true;
+				}
+			}
+			catch (const std::exception& e)
+			{
+				std::cerr << e.what() << '\n';
+				failed = true;
+			}
+		});
+		return !failed;
+	}
 
-	int taskResult = -1;
-	auto solverTask = std::async(std::launch::async, [&solver, &ctx, &taskResult] ()
+	// Called on the solver thread and on every worker of the pool when they start.
+	void initThread()
 	{
-		try
+		if (m_tracksMemory)
+		{
+			AllocationTracker::setCurrent(&m_allocations);
+		}
+
+		if (m_firstCore != NoCore)
+		{
+			pinCurrentThread(m_firstCore, m_coreCount);
+		}
+	}
+
+	void run()
+	{
+		initThread();
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while (true)
+		{
+			m_condition.wait(lock, [this] { return m_busy || m_exiting; });
+			if (!m_busy)
+			{
+				return;
+			}
+			lock.unlock();
+
+			TimelineRecorder* timeline = TimelineRecorder::active();
+			if (timeline && m_solver != m_namedSolver)
+			{
+				timeline->setThreadName("solver " + m_solver->getName());
+				m_namedSolver = m_solver;
+			}
+
+			SolverRace* const race = m_race;
+			bool succeeded = false;
+			bool finishedOnOriginal = false;
+			try
+			{
+				const auto solveBegin = std::chrono::steady_clock::now();
+				if (m_decomposition)
+				{
+					TIMELINE_SCOPE("solveBlocks");
+					succeeded = solveBlocks();
+					m_solveTime = std::chrono::steady_clock::now() - solveBegin;
+				}
+				else if (m_firings)
+				{
+					TIMELINE_SCOPE("applyFirings");
+					applyFirings(*m_firings);
+					finishedOnOriginal = !m_ctx.isSolved();
+				}
+
+				if (!m_decomposition)
+				{
+					if (!m_firings || finishedOnOriginal)
+					{
+						m_solver->solve(m_ctx);
+					}
+					m_solveTime = std::chrono::steady_clock::now() - solveBegin;
+
+					succeeded = !m_ctx.wasStopped();
+				}
+			}
+			catch (const std::exception& e)
+			{
+				std::cerr << e.what() << '\n';
+			}
+
+			if (race)
+			{
+				race->finish(m_runner, succeeded);
+			}
+
+			lock.lock();
+			m_succeeded = succeeded;
+			m_finishedOnOriginal = finishedOnOriginal;
+			m_busy = false;
+			m_condition.notify_all();
+		}
+	}
+
+public:
+	static constexpr size_t NoCore = SIZE_MAX;
+
+	explicit SolverThread(bool tracksMemory = false, size_t threadCount = std::thread::hardware_concurrency(), size_t firstCore = NoCore)
+		: m_tracksMemory(tracksMemory)
+		, m_firstCore(firstCore)
+		, m_coreCount(std::max<size_t>(threadCount, 1))
+		, m_threadPool(threadCount, [this] { initThread(); })
+		, m_solver(nullptr)
+		, m_namedSolver(nullptr)
+		, m_firings(nullptr)
+		, m_race(nullptr)
+		, m_runner(0)
+		, m_decomposition(nullptr)
+		, m_busy(false)
+		, m_exiting(false)
+		, m_succeeded(false)
+		, m_finishedOnOriginal(false)
+	{
+		m_thread = std::thread(&SolverThread::run, this);
+	}
+
+	SolverThread(const SolverThread&) = delete;
+
+	~SolverThread()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_exiting = true;
+			m_condition.notify_all();
+		}
+		m_thread.join();
+	}
+
+	// Makes the following solves report to the race as the given runner when they end.
+	void enterRace(SolverRace* race, size_t runner)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_race = race;
+		m_runner = runner;
+	}
+
+	// Asks the solve to stop, as the watchdog does, without waiting for it. It has to be
+	// ended still.
+	void cancel()
+	{
+		m_ctx.stop();
+		for (size_t blockIt = 0; m_decomposition && blockIt < m_decomposition->blockCount(); ++blockIt)
+		{
+			m_blockContexts[blockIt]->stop();
+		}
+	}
+
+	// Starts solving a copy of the graph. The solve is cancelled if it hasn't finished
+	// within a second. Given firings, such as an expanded solution of the reduced graph,
+	// are applied first, and the solver only runs if they leave debt. They have to stay
+	// alive until end.
+	void begin(const GraphSolver& solver, const Graph& graph, size_t moveLimit, const std::string& tracePath = "", const std::vector<int64_t>* firings = nullptr)
+	{
+		if (!tracePath.empty())
+		{
+			m_trace = std::make_unique<MoveTraceWriter>(tracePath, graph);
+		}
+
+		TimelineRecorder* timeline = TimelineRecorder::active();
+
+		if (m_tracksMemory)
 		{
-			solver.solve(ctx);
-			if (!ctx.wasStopped())
+			m_ctx.releaseBuffers();
+			m_allocations.reset();
+		}
+		AllocationTracker::Scope allocationScope(m_tracksMemory ? &m_allocations : nullptr);
+
+		const uint64_t copyBegin = timeline ? timelineNow() : 0;
+		m_ctx.reset(graph, moveLimit, m_trace.get(), timeline, &m_threadPool);
+		if (timeline)
+		{
+			timeline->recordSpan(TimelineCategory::Harness, "copyGraph", copyBegin, timelineNow());
+		}
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_solver = &solver;
+		m_firings = firings;
+		m_decomposition = nullptr;
+		m_deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(1000);
+		m_busy = true;
+		m_condition.notify_all();
+	}
+
+	// Starts solving copies of the blocks of a decomposition, which has to stay alive until
+	// end. All blocks share the second of a solve.
+	void beginBlocks(const GraphSolver& solver, const GraphDecomposition& decomposition, size_t moveLimit)
+	{
+		const size_t blockCount = decomposition.blockCount();
+		while (m_blockContexts.size() < blockCount)
+		{
+			m_blockContexts.push_back(std::make_unique<SolverContext>());
+		}
+
+		m_blockOrder.resize(blockCount);
+		std::iota(m_blockOrder.begin(), m_blockOrder.end(), size_t(0));
+		std::sort(m_blockOrder.begin(), m_blockOrder.end(), [&decomposition] (size_t a, size_t b) {
+			return decomposition.blockGraph(a).size() > decomposition.blockGraph(b).size();
+		});
+
+		TimelineRecorder* timeline = TimelineRecorder::active();
+
+		if (m_tracksMemory)
+		{
+			for (size_t blockIt = 0; blockIt < blockCount; ++blockIt)
 			{
-				taskResult = 0;
+				m_blockContexts[blockIt]->releaseBuffers();
 			}
+			m_allocations.reset();
 		}
-		catch (const std::exception& e)
+		AllocationTracker::Scope allocationScope(m_tracksMemory ? &m_allocations : nullptr);
+
+		const uint64_t copyBegin = timeline ? timelineNow() : 0;
+		for (size_t blockIt = 0; blockIt < blockCount; ++blockIt)
 		{
-			std::cerr << e.what() << '\n';
+			m_blockContexts[blockIt]->reset(decomposition.blockGraph(blockIt), moveLimit, nullptr, timeline);
 		}
-	});
+		if (timeline)
+		{
+			timeline->recordSpan(TimelineCategory::Harness, "copyBlocks", copyBegin, timelineNow());
+		}
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_solver = &solver;
+		m_firings = nullptr;
+		m_decomposition = &decomposition;
+		m_deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(1000);
+		m_busy = true;
+		m_condition.notify_all();
+	}
+
+	// Waits for the solve started by begin or beginBlocks. Returns false if it failed or
+	// timed out.
+	bool end(SolveResult& outResult)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+
+			bool finished;
+			{
+				TIMELINE_SCOPE("watchdogWait");
+				finished = m_condition.wait_until(lock, m_deadline, [this] { return !m_busy; });
+			}
+
+			if (!finished)
+			{
+				std::cout << "timeout\n";
+				TIMELINE_SCOPE("watchdogCancel");
+				cancel();
+				m_condition.wait(lock, [this] { return !m_busy; });
+			}
+		}
+
+		m_trace.reset();
+
+		if (!m_succeeded)
+		{
+			outResult.moveCount = 0;
+			return false;
+		}
+
+		outResult.moveCount = m_ctx.moveCount();
+		if (m_decomposition)
+		{
+			outResult.moveCount = 0;
+			for (size_t blockIt = 0; blockIt < m_decomposition->blockCount(); ++blockIt)
+			{
+				outResult.moveCount += m_blockContexts[blockIt]->moveCount();
+			}
+		}
+		outResult.solveSeconds = std::chrono::duration<double>(m_solveTime).count();
+		outResult.finishedOnOriginal = m_finishedOnOriginal;
+		if (m_tracksMemory)
+		{
+			outResult.allocations = m_allocations.stats();
+			outResult.residentBytes = currentResidentBytes();
+		}
+		return true;
+	}
+
+	// The state of the last solve. Only valid between end and the next begin.
+	__forceinline const SolverContext& context() const
+	{
+		return m_ctx;
+	}
+
+	// The block contexts of the last beginBlocks, in block order. Only valid between end and
+	// the next begin.
+	__forceinline const std::vector<std::unique_ptr<SolverContext>>& blockContexts() const
+	{
+		return m_blockContexts;
+	}
+};
 
-	const std::chrono::milliseconds timeout(1000);
-	const std::future_status status = solverTask.wait_for(timeout);
-	if (status == std::future_status::timeout || taskResult == -1)
+static bool trySolve(SolverThread& thread, const Graph& graph, const GraphSolver& solver, SolveResult& outResult, size_t moveLimit, const std::string& tracePath = "")
+{
+	thread.begin(solver, graph, moveLimit, tracePath);
+	return thread.end(outResult);
+}
+
+// Solves the reduced graph, then replays the expanded solution on the original graph and
+// lets the solver finish any debt it left. The reduction, both solves and the expansion
+// count towards the solve time, and only the moves on the original graph are counted and
+// traced.
+static bool trySolveReduced(SolverThread& thread, GraphReduction& reduction, std::vector<int64_t>& firings, const Graph& graph, const GraphSolver& solver, SolveResult& outResult, size_t moveLimit, const std::string& tracePath = "")
+{
+	static const HugePageVector<Move> noMoves;
+
+	auto reductionTime = std::chrono::steady_clock::duration::zero();
+	SolveResult reducedResult;
+	{
+		TIMELINE_SCOPE("reduce");
+		const auto reduceBegin = std::chrono::steady_clock::now();
+		reduction.reduce(graph);
+		reductionTime += std::chrono::steady_clock::now() - reduceBegin;
+	}
+
+	const Graph* solvedGraph = &reduction.reducedGraph();
+	const HugePageVector<Move>* reducedMoves = &noMoves;
+	if (!reduction.reducedGraph().isSolved())
+	{
+		thread.begin(solver, reduction.reducedGraph(), moveLimit);
+		if (!thread.end(reducedResult))
+		{
+			return false;
+		}
+		solvedGraph = &thread.context().graph();
+		reducedMoves = &thread.context().moves();
+	}
+
+	{
+		TIMELINE_SCOPE("expand");
+		const auto expandBegin = std::chrono::steady_clock::now();
+		reduction.expand(*reducedMoves, *solvedGraph, firings);
+		reductionTime += std::chrono::steady_clock::now() - expandBegin;
+	}
+
+	thread.begin(solver, graph, moveLimit, tracePath, &firings);
+	if (!thread.end(outResult))
 	{
-		if (status == std::future_status::timeout)
+		return false;
+	}
+
+	outResult.solveSeconds += reducedResult.solveSeconds + std::chrono::duration<double>(reductionTime).count();
+	return true;
+}
+
+// Solves the blocks of the graph in parallel, then replays their merged solution on the
+// graph and lets the solver finish any debt it left, which there shouldn't be. A graph of
+// a single block is solved as is. Like with --reduce, the decomposition, the solves and
+// the merge count towards the solve time, and only the moves on the graph are counted.
+static bool trySolveDecomposed(SolverThread& thread, GraphDecomposition& decomposition, std::vector<int64_t>& firings, const Graph& graph, const GraphSolver& solver, SolveResult& outResult, size_t moveLimit, const std::string& tracePath = "")
+{
+	auto decompositionTime = std::chrono::steady_clock::duration::zero();
+	{
+		TIMELINE_SCOPE("decompose");
+		const auto decomposeBegin = std::chrono::steady_clock::now();
+		decomposition.decompose(graph);
+		decompositionTime += std::chrono::steady_clock::now() - decomposeBegin;
+	}
+
+	if (decomposition.blockCount() < 2)
+	{
+		if (!trySolve(thread, graph, solver, outResult, moveLimit, tracePath))
 		{
-			std::cout << "timeout\n";
-			ctx.stop();
-			solverTask.wait();
+			return false;
 		}
-		outMoves.clear();
+
+		outResult.solveSeconds += std::chrono::duration<double>(decompositionTime).count();
+		return true;
+	}
+
+	SolveResult blocksResult;
+	thread.beginBlocks(solver, decomposition, moveLimit);
+	if (!thread.end(blocksResult))
+	{
+		return false;
+	}
+
+	{
+		TIMELINE_SCOPE("merge");
+		const auto mergeBegin = std::chrono::steady_clock::now();
+		decomposition.merge(thread.blockContexts(), graph.size(), firings);
+		decompositionTime += std::chrono::steady_clock::now() - mergeBegin;
+	}
+
+	thread.begin(solver, graph, moveLimit, tracePath, &firings);
+	if (!thread.end(outResult))
+	{
 		return false;
 	}
 
+	outResult.solveSeconds += blocksResult.solveSeconds + std::chrono::duration<double>(decompositionTime).count();
 	return true;
 }
 
+// How much --reduce shrank the graphs of one cell.
+struct ReductionStats
+{
+	size_t solveCount = 0;
+	size_t finishedOnOriginalCount = 0;
+	double nodeFraction = 0.0;
+	double edgeFraction = 0.0;
+
+	void add(const Graph& graph, const GraphReduction& reduction, const SolveResult& result)
+	{
+		++solveCount;
+		finishedOnOriginalCount += result.finishedOnOriginal ? 1 : 0;
+		nodeFraction += (double)reduction.reducedGraph().size() / (double)graph.size();
+		edgeFraction += (double)reduction.reducedGraph().topology().edgeCount() / (double)graph.topology().edgeCount();
+	}
+
+	void print(std::ostream& os) const
+	{
+		if (solveCount == 0)
+		{
+			return;
+		}
+
+		os << "Reduced to " << std::fixed << std::setprecision(1) << 100.0 * nodeFraction / (double)solveCount << "% of the nodes and "
+			<< 100.0 * edgeFraction / (double)solveCount << "% of the edges, " << finishedOnOriginalCount << " of " << solveCount
+			<< " solves finished on the original graph\n";
+	}
+};
+
+// How finely --decompose split the graphs of one cell.
+struct DecompositionStats
+{
+	size_t solveCount = 0;
+	size_t finishedOnOriginalCount = 0;
+	size_t blockCount = 0;
+	double largestBlockFraction = 0.0;
+
+	void add(const Graph& graph, const GraphDecomposition& decomposition, const SolveResult& result)
+	{
+		++solveCount;
+		finishedOnOriginalCount += result.finishedOnOriginal ? 1 : 0;
+		blockCount += decomposition.blockCount();
+
+		size_t largestBlockSize = 0;
+		for (size_t blockIt = 0; blockIt < decomposition.blockCount(); ++blockIt)
+		{
+			largestBlockSize = std::max(largestBlockSize, decomposition.blockGraph(blockIt).size());
+		}
+		largestBlockFraction += (double)largestBlockSize / (double)graph.size();
+	}
+
+	void print(std::ostream& os) const
+	{
+		if (solveCount == 0)
+		{
+			return;
+		}
+
+		os << "Split into " << std::fixed << std::setprecision(1) << (double)blockCount / (double)solveCount << " blocks, the largest with "
+			<< 100.0 * largestBlockFraction / (double)solveCount << "% of the nodes, " << finishedOnOriginalCount << " of " << solveCount
+			<< " solves finished on the original graph\n";
+	}
+};
+
+// What the solves of one cell allocated with --track-memory. Normalized to the nodes of
+// the graphs, as the graphs of a cell differ in their edges but not their size.
+struct MemoryStats
+{
+	size_t solveCount = 0;
+	size_t nodeCount = 0;
+	uint64_t peakBytes = 0;
+	uint64_t allocatedBytes = 0;
+	uint64_t allocationCount = 0;
+	size_t residentBytes = 0;
+
+	void add(const Graph& graph, const SolveResult& result)
+	{
+		++solveCount;
+		nodeCount += graph.size();
+		peakBytes += result.allocations.peakBytes;
+		allocatedBytes += result.allocations.allocatedBytes;
+		allocationCount += result.allocations.allocationCount;
+		residentBytes = std::max(residentBytes, result.residentBytes);
+	}
+
+	double peakBytesPerNode() const
+	{
+		return nodeCount > 0 ? (double)peakBytes / (double)nodeCount : 0.0;
+	}
+
+	double allocatedBytesPerNode() const
+	{
+		return nodeCount > 0 ? (double)allocatedBytes / (double)nodeCount : 0.0;
+	}
+
+	void print(std::ostream& os) const
+	{
+		if (solveCount == 0)
+		{
+			return;
+		}
+
+		const double mebibyte = 1024.0 * 1024.0;
+		const double solves = (double)solveCount;
+		os << "Memory per solve: peak " << std::fixed << std::setprecision(2) << (double)peakBytes / solves / mebibyte << " MiB ("
+			<< std::setprecision(1) << peakBytesPerNode() << " B/node), "
+			<< std::setprecision(2) << (double)allocatedBytes / solves / mebibyte << " MiB allocated ("
+			<< std::setprecision(1) << allocatedBytesPerNode() << " B/node) in "
+			<< (double)allocationCount / solves << " allocations, resident set up to "
+			<< std::setprecision(2) << (double)residentBytes / mebibyte << " MiB\n";
+	}
+};
+
 static auto enumSolvers()
 {
-	const auto solverDir = getExecutableDir() / "solvers";
+	TIMELINE_SCOPE("enumSolvers");
 
 	std::vector<std::unique_ptr<GraphSolver>> outSolvers;
+
+#if DOLLARGAME_MONOLITHIC
+	for (const auto& solver : staticSolvers())
+	{
+		outSolvers.push_back(std::make_unique<GraphSolver>(solver));
+	}
+#else
+	const auto solverDir = getExecutableDir() / "solvers";
+
 	for (auto solverDirIt : std::experimental::filesystem::directory_iterator(solverDir))
 	{
 		const auto& solverPath = solverDirIt.path();
@@ -115,18 +776,29 @@ static auto enumSolvers()
 		if (solverPath.extension() == ".so")
 #endif
 		{
+			TIMELINE_SCOPE("loadSolver");
 			auto solver = std::make_unique<GraphSolver>(solverPath.string());
 			outSolvers.push_back(std::move(solver));
 		}
 	}
+#endif
 	return outSolvers;
 }
 
 static auto enumGenerators()
 {
-	const auto generatorDir = getExecutableDir() / "generators";
+	TIMELINE_SCOPE("enumGenerators");
 
 	std::vector<std::unique_ptr<GraphGenerator>> outGenerators;
+
+#if DOLLARGAME_MONOLITHIC
+	for (const auto& generator : staticGenerators())
+	{
+		outGenerators.push_back(std::make_unique<GraphGenerator>(generator));
+	}
+#else
+	const auto generatorDir = getExecutableDir() / "generators";
+
 	for (auto generatorDirIt : std::experimental::filesystem::directory_iterator(generatorDir))
 	{
 		const auto& solverPath = generatorDirIt.path();
@@ -136,344 +808,1668 @@ static auto enumGenerators()
 		if (solverPath.extension() == ".so")
 #endif
 		{
+			TIMELINE_SCOPE("loadGenerator");
 			auto solver = std::make_unique<GraphGenerator>(solverPath.string());
 			outGenerators.push_back(std::move(solver));
 		}
 	}
+#endif
 	return outGenerators;
 }
 
-void compare(
-	GraphGenerator& generator, 
-	std::vector<std::unique_ptr<GraphSolver>>& solvers, 
-	size_t graphSize,
-	size_t iterations)
+typedef std::map<std::string, std::vector<std::string>> ArgMap;
+
+constexpr size_t DefaultMoveLimit = 1000000;
+
+// How often a sweep with a --checkpoint saves it in the middle of a cell.
+constexpr std::chrono::seconds CheckpointSaveInterval(5);
+
+static void requireArgument(const ArgMap& args, const std::string& name)
 {
-	std::vector<size_t> nodeCounts = {
-		graphSize,
+	const auto it = args.find(name);
+	if (it == args.cend() || it->second.empty())
+	{
+		std::cerr << "Missing argument: " << name << "\n";
+		std::exit(-1);
+	}
+}
+
+static std::vector<std::unique_ptr<GraphSolver>> findSolvers(const std::vector<std::string>& names)
+{
+	auto allSolvers = enumSolvers();
+
+	std::vector<std::unique_ptr<GraphSolver>> solvers;
+	for (const auto& name : names)
+	{
+		bool foundSolver = false;
+		for (auto&& solver : allSolvers)
+		{
+			if (solver && solver->getName() == name)
+			{
+				solvers.push_back(std::move(solver));
+				foundSolver = true;
+				break;
+			}
+		}
+
+		if (!foundSolver)
+		{
+			std::cerr << "Solver \"" << name << "\" not found.\n";
+			exit(-1);
+		}
+	}
+	return solvers;
+}
+
+static std::vector<std::unique_ptr<GraphGenerator>> findGenerators(const std::vector<std::string>& names)
+{
+	auto allGenerators = enumGenerators();
+
+	std::vector<std::unique_ptr<GraphGenerator>> generators;
+	for (const auto& name : names)
+	{
+		bool foundGenerator = false;
+		for (auto&& generator : allGenerators)
+		{
+			if (generator && generator->getName() == name)
+			{
+				generators.push_back(std::move(generator));
+				foundGenerator = true;
+				break;
+			}
+		}
+
+		if (!foundGenerator)
+		{
+			std::cerr << "Generator \"" << name << "\" not found.\n";
+			exit(-1);
+		}
+	}
+	return generators;
+}
+
+static size_t parseCount(const ArgMap& args, const std::string& name)
+{
+	try
+	{
+		return std::stoull(args.at(name).at(0));
+	}
+	catch (const std::exception&)
+	{
+		std::cerr << "The " << name << " must be a positive integer.\n";
+		exit(-1);
+	}
+}
+
+static size_t parseIterations(const ArgMap& args)
+{
+	return parseCount(args, "--iterations");
+}
+
+// Parses a relative precision such as "1%" or "0.5" (percent sign optional) into a fraction.
+static double parsePrecision(const ArgMap& args)
+{
+	double precision = 0.0;
+	try
+	{
+		std::string value = args.at("--precision").at(0);
+		if (!value.empty() && value.back() == '%')
+		{
+			value.pop_back();
+		}
+		precision = std::stod(value) / 100.0;
+	}
+	catch (const std::exception&)
+	{
+	}
+
+	if (!(precision > 0.0))
+	{
+		std::cerr << "The --precision must be a positive percentage.\n";
+		exit(-1);
+	}
+	return precision;
+}
+
+static std::vector<size_t> parseGraphSizes(const ArgMap& args)
+{
+	std::vector<size_t> graphSizes;
+	try
+	{
+		for (const auto& argGraphSize : args.at("--graph-sizes"))
+		{
+			graphSizes.push_back(std::stoull(argGraphSize));
+		}
+	}
+	catch (const std::exception&)
+	{
+		std::cerr << "The --graph-sizes must be positive integers.\n";
+		exit(-1);
+	}
+	return graphSizes;
+}
+
+static std::pair<NodeValue, NodeValue> parseValueRange(const ArgMap& args)
+{
+	const auto it = args.find("--value-range");
+	if (it == args.cend())
+	{
+		return { -2, 3 };
+	}
+
+	NodeValue minValue = 0;
+	NodeValue maxValue = 0;
+	try
+	{
+		minValue = std::stoi(it->second.at(0));
+		maxValue = std::stoi(it->second.at(1));
+	}
+	catch (const std::exception&)
+	{
+		std::cerr << "The --value-range must be two integers <min> <max>.\n";
+		exit(-1);
+	}
+
+	// Generators draw until the graph is unsolved but solvable, which takes a node in debt
+	// and enough dollars to pay for it.
+	if (minValue >= 0 || maxValue <= 0)
+	{
+		std::cerr << "The --value-range must have a negative <min> and a positive <max>.\n";
+		exit(-1);
+	}
+	return { minValue, maxValue };
+}
+
+// Whether --decompose is given, which can't be combined with --reduce.
+static bool parseDecompose(const ArgMap& args)
+{
+	const bool decompose = args.find("--decompose") != args.cend();
+	if (decompose && args.find("--reduce") != args.cend())
+	{
+		std::cerr << "The --decompose can't be combined with --reduce.\n";
+		exit(-1);
+	}
+	return decompose;
+}
+
+// Depth of the --pipeline, 0 to generate every graph when it's needed.
+static size_t parsePipelineDepth(const ArgMap& args)
+{
+	return args.find("--pipeline") != args.cend() ? parseCount(args, "--pipeline") : 0;
+}
+
+// The cells of a sweep in the order they're run, generators first.
+template<typename Generators>
+static std::vector<PipelineCell> makePipelineCells(const Generators& generators, const std::vector<size_t>& graphSizes)
+{
+	std::vector<PipelineCell> cells;
+	for (const auto& generator : generators)
+	{
+		for (const size_t graphSize : graphSizes)
+		{
+			cells.push_back({ &*generator, graphSize, {} });
+		}
+	}
+	return cells;
+}
+
+// The --seed and --shard of a sweep. Returns false without a --seed, when the sweep draws
+// its graphs from a random device and is its own only shard.
+static bool parseShard(const ArgMap& args, Checkpoint::Shard& outShard)
+{
+	const bool seeded = args.find("--seed") != args.cend();
+	if (seeded)
+	{
+		outShard.seed = parseCount(args, "--seed");
+	}
+
+	if (args.find("--shard") != args.cend())
+	{
+		if (!seeded)
+		{
+			std::cerr << "The --shard requires a --seed, so that all shards agree on the graphs.\n";
+			exit(-1);
+		}
+
+		requireArgument(args, "--shard");
+		const std::string& value = args.at("--shard")[0];
+		const size_t slash = value.find('/');
+		try
+		{
+			if (slash == std::string::npos)
+			{
+				throw std::invalid_argument("Missing shard count");
+			}
+			outShard.index = std::stoull(value.substr(0, slash));
+			outShard.count = std::stoull(value.substr(slash + 1));
+		}
+		catch (const std::exception&)
+		{
+			outShard.count = 0;
+		}
+
+		if (outShard.index >= outShard.count)
+		{
+			std::cerr << "The --shard must be INDEX/COUNT, with INDEX below COUNT.\n";
+			exit(-1);
+		}
+	}
+	return seeded;
+}
+
+// Iterations of the cell that the shard runs. Shards take the (cell, iteration) pairs of the
+// sweep in turns, so every shard gets about as many trials of every cell.
+static std::vector<size_t> getShardIterations(const Checkpoint::Shard& shard, size_t cellIndex, size_t iterations)
+{
+	std::vector<size_t> shardIterations;
+	for (size_t iteration = 0; iteration < iterations; ++iteration)
+	{
+		if ((cellIndex * iterations + iteration) % shard.count == shard.index)
+		{
+			shardIterations.push_back(iteration);
+		}
+	}
+	return shardIterations;
+}
+
+// Hashes the key of a trial with FNV-1a. The generator name is hashed instead of its
+// position, so that a graph keeps its seed when generators are added to or removed from
+// the matrix.
+static uint64_t hashTrialKey(const std::string& generatorName, size_t graphSize, size_t trial)
+{
+	uint64_t hash = 14695981039346656037ull;
+	const auto mix = [&hash] (uint64_t value)
+	{
+		for (int byteIt = 0; byteIt < 8; ++byteIt)
+		{
+			hash ^= (value >> (byteIt * 8)) & 0xff;
+			hash *= 1099511628211ull;
+		}
+	};
+
+	for (const char c : generatorName)
+	{
+		mix((uint8_t)c);
+	}
+	mix(graphSize);
+	mix(trial);
+
+	return hash;
+}
+
+// Seed of one trial of a sweep with a --seed, which only depends on the trial and not on
+// the shard that runs it or what ran before.
+static uint64_t getTrialSeed(uint64_t seed, const std::string& generatorName, size_t graphSize, size_t iteration)
+{
+	return splitMix64(hashTrialKey(generatorName, graphSize, iteration) ^ splitMix64(seed));
+}
+
+// Writes the table of average moves, a column per generator and a row per size.
+static void writeResultTable(const std::string& filename, const std::vector<std::string>& generatorNames, const std::vector<size_t>& graphSizes, const std::vector<std::vector<double>>& results)
+{
+	std::ofstream os(filename);
+
+	for (const std::string& generatorName : generatorNames)
+	{
+		os << ';' << generatorName;
+	}
+	os << '\n';
+
+	for (size_t graphSizeIt = 0; graphSizeIt < graphSizes.size(); ++graphSizeIt)
+	{
+		os << graphSizes[graphSizeIt];
+		for (size_t generatorIt = 0; generatorIt < generatorNames.size(); ++generatorIt)
+		{
+			os << ';' << results[generatorIt][graphSizeIt];
+		}
+		os << '\n';
+	}
+}
+
+// Returns where the moves of one solve should be traced, or an empty string if tracing is
+// disabled. Retries of the same iteration overwrite the trace of the failed attempt.
+static std::string getTracePath(const ArgMap& args, const GraphSolver& solver, const GraphGenerator& generator, size_t graphSize, size_t iteration)
+{
+	const auto it = args.find("--trace-moves");
+	if (it == args.cend() || it->second.empty())
+	{
+		return "";
+	}
+
+	const std::experimental::filesystem::path traceDir = it->second[0];
+	std::experimental::filesystem::create_directories(traceDir);
+
+	const std::string filename = solver.getName() + "-" + generator.getName() + "-" + std::to_string(graphSize) + "-" + std::to_string(iteration) + ".dgtrace";
+	return (traceDir / filename).string();
+}
+
+static void printSolvers()
+{
+	const auto solvers = enumSolvers();
+
+	size_t maxNameLength = 0;
+	for (auto&& solver : solvers)
+	{
+		maxNameLength = std::max(maxNameLength, solver->getName().length());
+	}
+
+	std::cout << "\nSolvers available:\n\n";
+	for (auto&& solver : solvers)
+	{
+		std::cout << "  " << std::setw(maxNameLength) << solver->getName() << " - " << solver->getDescription() << '\n';
+	}
+}
+
+static void printGenerators()
+{
+	const auto generators = enumGenerators();
+
+	size_t maxNameLength = 0;
+	for (auto&& generator : generators)
+	{
+		maxNameLength = std::max(maxNameLength, generator->getName().length());
+	}
+
+	std::cout << "\nGenerators available:\n\n";
+	for (auto&& generator : generators)
+	{
+		std::cout << "  " << std::setw(maxNameLength) << generator->getName() << " - " << generator->getDescription() << '\n';
+	}
+}
+
+static void printUsage()
+{
+	std::cout << "Usage:\n\n";
+	std::cout << "  DollarGame --solver <solver> <options>\n";
+	std::cout << "  DollarGame --solvers <solvers> <options>\n";
+	std::cout << "  DollarGame --portfolio <solvers> <options>\n";
+	std::cout << "  DollarGame --record-baseline <file> | --check-baseline <file> --solvers <solvers> [<options>]\n";
+	std::cout << "  DollarGame --laplacian-benchmark --generators <generators> --graph-sizes N... [--iterations N]\n";
+	std::cout << "  DollarGame --merge <shard files> [--result <file>] [--output <file>]\n\n";
+	std::cout << "Options:\n\n";
+	const size_t w = 14;
+	std::cout << "  --solver      "  << std::setw(w) << "<solver>" << " - Benchmark a single solver.\n";
+	std::cout << "  --solvers     "  << std::setw(w) << "<solvers>" << " - Compare several solvers head-to-head on the same graphs.\n";
+	std::cout << "  --portfolio   "  << std::setw(w) << "<solvers>" << " - Race several solvers on every graph, and take the first solution.\n";
+	std::cout << "  --generators  "  << std::setw(w) << "<generators>" << " - Specify which generators should be used to generate graphs.\n";
+	std::cout << "  --graph-sizes "  << std::setw(w) << "N..." << " - Sizes of the graphs.\n";
+	std::cout << "  --iterations  "  << std::setw(w) << "N" << " - Number of iterations to run per generator and size.\n";
+	std::cout << "  --value-range "  << std::setw(w) << "MIN MAX" << " - Range of the initial node values. Defaults to -2 3.\n";
+	std::cout << "  --trace-moves "  << std::setw(w) << "<dir>" << " - Stream the moves of every solve to a binary trace file in <dir>.\n";
+	std::cout << "  --trace       "  << std::setw(w) << "<file>" << " - Write a Chrome/Perfetto timeline of the run to <file>.\n";
+	std::cout << "  --huge-pages  "  << std::setw(w) << "" << " - Back large graph buffers with transparent huge pages (Linux).\n";
+	std::cout << "  --reduce      "  << std::setw(w) << "" << " - Prune the trees and contract the chains of the graph before solving. Does nothing on Torus.\n";
+	std::cout << "  --decompose   "  << std::setw(w) << "" << " - Solve the biconnected components of the graph in parallel.\n";
+	std::cout << "  --pipeline    "  << std::setw(w) << "DEPTH" << " - Generate up to DEPTH graphs ahead on another thread while solving.\n";
+	std::cout << "  --track-memory"  << std::setw(w) << "" << " - Report the bytes every solve allocates, per node, and the resident set size.\n";
+	std::cout << '\n';
+	std::cout << "Single solver options:\n\n";
+	std::cout << "  --result      "  << std::setw(w) << "<file>" << " - Where to write the table of averages. Defaults to result.csv.\n";
+	std::cout << "  --output      "  << std::setw(w) << "<file>" << " - Append every finished cell to <file>, as JSON Lines for .jsonl and CSV otherwise.\n";
+	std::cout << "  --per-trial   "  << std::setw(w) << "" << " - Also append every finished iteration to the --output.\n";
+	std::cout << "  --checkpoint  "  << std::setw(w) << "<file>" << " - Record finished iterations in <file>.\n";
+	std::cout << "  --resume      "  << std::setw(w) << "" << " - Skip the iterations recorded in the --checkpoint.\n";
+	std::cout << "  --precision   "  << std::setw(w) << "PERCENT" << " - Run each cell until the 95% CI of its mean is within PERCENT of the mean.\n";
+	std::cout << "  --precision-of"  << std::setw(w) << "moves|seconds" << " - Which mean the --precision applies to. Defaults to moves.\n";
+	std::cout << "  --min-iterations " << std::setw(w - 3) << "N" << " - Fewest iterations per cell with --precision. Defaults to 10.\n";
+	std::cout << "  --max-iterations " << std::setw(w - 3) << "N" << " - Most iterations per cell with --precision. Defaults to --iterations or 10000.\n";
+	std::cout << "  --seed        "  << std::setw(w) << "N" << " - Derive the graph of every trial from N, independently of the others.\n";
+	std::cout << "  --shard       "  << std::setw(w) << "INDEX/COUNT" << " - Run every COUNT-th trial of the sweep, from INDEX on. Requires --seed.\n";
+	std::cout << "  --cache       "  << std::setw(w) << "<file>" << " - Take the results of graphs solved before from <file>, and add new ones.\n";
+	std::cout << '\n';
+	std::cout << "Regression benchmark options:\n\n";
+	std::cout << "  --record-baseline "  << std::setw(w) << "<file>" << " - Store solve times and move counts as a baseline.\n";
+	std::cout << "  --check-baseline  "  << std::setw(w) << "<file>" << " - Compare against a baseline. Exits with 1 on regressions.\n";
+	std::cout << "  --threshold       "  << std::setw(w) << "PERCENT" << " - Slowdown that counts as a regression. Defaults to 10.\n";
+	std::cout << "  --solvers is required. Defaults to all generators, sizes 100 and 1000, values -2 5 and 10 iterations.\n";
+	std::cout << '\n';
+
+	printSolvers();
+
+	printGenerators();
+}
+
+static void benchmarkSolver(ArgMap args)
+{
+	// With --precision, every cell runs until the confidence interval of its mean is narrow
+	// enough, between --min-iterations and --max-iterations trials. Otherwise every cell
+	// runs exactly --iterations trials.
+	const bool adaptive = args.find("--precision") != args.cend();
+
+	requireArgument(args, "--solver");
+	requireArgument(args, "--generators");
+	if (!adaptive)
+	{
+		requireArgument(args, "--iterations");
+	}
+	requireArgument(args, "--graph-sizes");
+
+	const auto solver = std::move(findSolvers({ args["--solver"][0] })[0]);
+	const auto generators = findGenerators(args["--generators"]);
+
+	double precision = 0.0;
+	bool precisionOfSeconds = false;
+	size_t minIterations = 0;
+	size_t iterations = 0;
+	if (adaptive)
+	{
+		precision = parsePrecision(args);
+		minIterations = args.find("--min-iterations") != args.cend() ? parseCount(args, "--min-iterations") : 10;
+		iterations = args.find("--max-iterations") != args.cend() ? parseCount(args, "--max-iterations")
+			: args.find("--iterations") != args.cend() ? parseIterations(args) : 10000;
+
+		if (args.find("--precision-of") != args.cend())
+		{
+			requireArgument(args, "--precision-of");
+			const std::string& metric = args["--precision-of"][0];
+			if (metric != "moves" && metric != "seconds")
+			{
+				std::cerr << "The --precision-of must be moves or seconds.\n";
+				exit(-1);
+			}
+			precisionOfSeconds = metric == "seconds";
+		}
+
+		// The confidence interval needs at least two samples.
+		minIterations = std::max<size_t>(minIterations, 2);
+		if (iterations < minIterations)
+		{
+			std::cerr << "The --max-iterations must not be smaller than the --min-iterations.\n";
+			exit(-1);
+		}
+	}
+	else
+	{
+		iterations = parseIterations(args);
+	}
+
+	Checkpoint::Shard shard;
+	const bool seeded = parseShard(args, shard);
+	if (adaptive && shard.count > 1)
+	{
+		std::cerr << "The --shard can't be combined with --precision, which needs all trials of a cell.\n";
+		exit(-1);
+	}
+
+	const auto isCellFinished = [&] (const CheckpointCell& cell, size_t cellIterations)
+	{
+		if (cell.completedIterations >= cellIterations)
+		{
+			return true;
+		}
+		else if (!adaptive || cell.completedIterations < minIterations)
+		{
+			return false;
+		}
+
+		const double average = precisionOfSeconds ? cell.averageSeconds() : cell.averageMoves();
+		const double variance = precisionOfSeconds ? cell.secondsVariance() : cell.movesVariance();
+		return confidenceHalfWidth(variance, precisionOfSeconds ? cell.timedIterations : cell.completedIterations) <= precision * std::abs(average);
+	};
+	const std::vector<size_t> graphSizes = parseGraphSizes(args);
+	const auto valueRange = parseValueRange(args);
+
+	const std::string defaultResultFilename = shard.count > 1 ? "result-" + std::to_string(shard.index) + "-of-" + std::to_string(shard.count) + ".csv" : "result.csv";
+	const std::string resultFilename = args.find("--result") != args.cend() && !args["--result"].empty() ? args["--result"][0] : defaultResultFilename;
+	const bool perTrial = args.find("--per-trial") != args.cend();
+	const bool reduce = args.find("--reduce") != args.cend();
+	const bool decompose = parseDecompose(args);
+	const bool tracksMemory = args.find("--track-memory") != args.cend();
+
+	Checkpoint::Sweep sweep;
+	for (const auto& generator : generators)
+	{
+		sweep.generators.push_back(generator->getName());
+	}
+	sweep.graphSizes = graphSizes;
+	sweep.minValue = valueRange.first;
+	sweep.maxValue = valueRange.second;
+	sweep.reduce = reduce;
+	sweep.decompose = decompose;
+
+	std::unique_ptr<ResultStream> output;
+	std::unique_ptr<Checkpoint> checkpoint;
+	std::unique_ptr<ResultCache> cache;
+
+	// Cached results belong to the solver, the way it was run, and the code that ran it: the
+	// module of the solver and the harness, which validates, reduces and decomposes.
+	const std::string cacheSolverKey = solver->getName() + (reduce ? "/reduce" : decompose ? "/decompose" : "");
+	uint64_t cacheModuleHash = 0;
+
+	std::random_device rd;
+	std::mt19937 r(rd());
+
+	try
+	{
+		if (args.find("--output") != args.cend())
+		{
+			requireArgument(args, "--output");
+			const std::string& outputFilename = args["--output"][0];
+			output = std::make_unique<ResultStream>(outputFilename, ResultStream::formatFromFilename(outputFilename));
+		}
+
+		if (args.find("--checkpoint") != args.cend())
+		{
+			requireArgument(args, "--checkpoint");
+			checkpoint = std::make_unique<Checkpoint>(args["--checkpoint"][0], solver->getName(), iterations);
+			checkpoint->setSweep(sweep);
+			if (seeded)
+			{
+				checkpoint->setShard(shard);
+			}
+		}
+
+		if (args.find("--cache") != args.cend())
+		{
+			requireArgument(args, "--cache");
+			cache = std::make_unique<ResultCache>(args["--cache"][0]);
+
+			cacheModuleHash = hashFile(getExecutablePath());
+			if (!solver->getModulePath().empty())
+			{
+				cacheModuleHash = splitMix64(cacheModuleHash) ^ hashFile(solver->getModulePath());
+			}
+		}
+
+		if (args.find("--resume") != args.cend())
+		{
+			if (!checkpoint)
+			{
+				std::cerr << "The --resume requires a --checkpoint.\n";
+				exit(-1);
+			}
+
+			if (checkpoint->load())
+			{
+				std::istringstream(checkpoint->randomState()) >> r;
+				std::cout << "Resuming from " << args["--checkpoint"][0] << "\n";
+			}
+		}
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << '\n';
+		exit(-1);
+	}
+
+	// Without a checkpoint, progress is still tracked in a local one that is never saved.
+	Checkpoint localProgress("", solver->getName(), iterations);
+	Checkpoint& progress = checkpoint ? *checkpoint : localProgress;
+
+	// Shards write the totals of their cells next to their result table, for --merge.
+	std::unique_ptr<Checkpoint> shardFile;
+	if (args.find("--shard") != args.cend())
+	{
+		shardFile = std::make_unique<Checkpoint>(std::experimental::filesystem::path(resultFilename).replace_extension(".shard").string(), solver->getName(), iterations);
+		shardFile->setShard(shard);
+		shardFile->setSweep(sweep);
+	}
+
+	// With a --seed, every cell runs the iterations of its shard, each from a seed of its own.
+	std::vector<PipelineCell> cells = makePipelineCells(generators, graphSizes);
+	std::vector<std::vector<size_t>> shardIterations(cells.size());
+	if (seeded)
+	{
+		for (size_t cellIndex = 0; cellIndex < cells.size(); ++cellIndex)
+		{
+			PipelineCell& cell = cells[cellIndex];
+			shardIterations[cellIndex] = getShardIterations(shard, cellIndex, iterations);
+
+			const CheckpointCell& cellProgress = progress.cell(cell.generator->getName(), cell.graphSize);
+			for (size_t trialIt = cellProgress.completedIterations; trialIt < shardIterations[cellIndex].size(); ++trialIt)
+			{
+				cell.trialSeeds.push_back(getTrialSeed(shard.seed, cell.generator->getName(), cell.graphSize, shardIterations[cellIndex][trialIt]));
+			}
+		}
+	}
+
+	size_t totalIterations = 0;
+
+	GraphPipeline pipeline(std::move(cells), r, valueRange.first, valueRange.second, parsePipelineDepth(args), checkpoint != nullptr);
+
+	// The checkpoint is saved when a cell is finished, and in between at most every
+	// CheckpointSaveInterval, as rewriting it after every trial can cost more than the
+	// trials. An interrupted sweep repeats the trials since the last save.
+	auto lastCheckpointSave = std::chrono::steady_clock::now();
+	const auto saveCheckpoint = [&checkpoint, &lastCheckpointSave] {
+		checkpoint->save();
+		lastCheckpointSave = std::chrono::steady_clock::now();
+	};
+	SolverThread solverThread(tracksMemory);
+	SolveResult result;
+	GraphReduction reduction;
+	GraphDecomposition decomposition;
+	std::vector<int64_t> firings;
+
+	std::vector<std::vector<double>> results;
+	results.resize(generators.size());
+	for (auto&& result : results)
+	{
+		result.resize(graphSizes.size());
+	}
+	std::vector<std::vector<double>> memoryResults = results;
+
+	for (size_t generatorIt = 0; generatorIt < generators.size(); ++generatorIt)
+	{
+		const auto& generator = generators[generatorIt];
+		for (size_t graphSizeIt = 0; graphSizeIt < graphSizes.size(); ++graphSizeIt)
+		{
+			const size_t graphSize = graphSizes[graphSizeIt];
+			const size_t cellIndex = generatorIt * graphSizes.size() + graphSizeIt;
+
+			CheckpointCell& cell = progress.cell(generator->getName(), graphSize);
+			const size_t cellIterations = seeded ? shardIterations[cellIndex].size() : iterations;
+			const bool cellWasFinished = isCellFinished(cell, cellIterations);
+
+			std::cout << "Generator: " << generator->getName() << " - Size: " << graphSize << (cellWasFinished ? " (resumed)" : "") << "\n";
+
+			ReductionStats reductionStats;
+			DecompositionStats decompositionStats;
+			MemoryStats memoryStats;
+			size_t cachedCount = 0;
+			size_t trialCount = 0;
+			while (!isCellFinished(cell, cellIterations))
+			{
+				const size_t iteration = seeded ? shardIterations[cellIndex][cell.completedIterations] : cell.completedIterations;
+				size_t attempt = 0;
+				while (true)
+				{
+					const Graph& graph = attempt++ == 0 ? pipeline.next(cellIndex) : pipeline.retry(cellIndex);
+
+					// Graphs seen before take the result of their first solve, without a trace.
+					GraphHash graphHash;
+					ResultCache::Entry cached;
+					const bool isCached = cache && cache->find(cacheSolverKey, cacheModuleHash, graphHash = hashGraph(graph), cached);
+
+					bool solveSuccessful;
+
+					if (isCached)
+					{
+						result.moveCount = cached.moveCount;
+						result.solveSeconds = cached.solveSeconds;
+						result.finishedOnOriginal = false;
+						solveSuccessful = true;
+					}
+					else
+					{
+						const std::string tracePath = getTracePath(args, *solver, *generator, graphSize, iteration);
+						solveSuccessful = reduce ? trySolveReduced(solverThread, reduction, firings, graph, *solver, result, DefaultMoveLimit, tracePath)
+							: decompose ? trySolveDecomposed(solverThread, decomposition, firings, graph, *solver, result, DefaultMoveLimit, tracePath)
+							: trySolve(solverThread, graph, *solver, result, DefaultMoveLimit, tracePath);
+
+						if (solveSuccessful && cache)
+						{
+							cache->insert(cacheSolverKey, cacheModuleHash, graphHash, { result.moveCount, result.solveSeconds });
+						}
+					}
+
+					if (solveSuccessful)
+					{
+						// The seconds of cached solves were measured by an earlier run, so they
+						// stay out of the seconds of the cell.
+						++trialCount;
+						if (isCached)
+						{
+							cell.addCachedTrial(result.moveCount);
+							++cachedCount;
+						}
+						else
+						{
+							cell.addTrial(result.moveCount, result.solveSeconds);
+							if (reduce)
+							{
+								reductionStats.add(graph, reduction, result);
+							}
+							else if (decompose)
+							{
+								decompositionStats.add(graph, decomposition, result);
+							}
+						}
+
+						if (tracksMemory && !isCached)
+						{
+							memoryStats.add(graph, result);
+						}
+
+						if (output && perTrial)
+						{
+							if (isCached)
+							{
+								output->writeCachedTrial(generator->getName(), graphSize, iteration, result.moveCount, result.solveSeconds);
+							}
+							else
+							{
+								output->writeTrial(generator->getName(), graphSize, iteration, result.moveCount, result.solveSeconds);
+							}
+						}
+
+						if (checkpoint)
+						{
+							checkpoint->setRandomState(pipeline.randomState());
+							if (std::chrono::steady_clock::now() - lastCheckpointSave >= CheckpointSaveInterval)
+							{
+								saveCheckpoint();
+							}
+						}
+						break;
+					}
+				}
+			}
+
+			if (checkpoint && !cellWasFinished)
+			{
+				saveCheckpoint();
+			}
+
+			const double avg = cell.averageMoves();
+			const double movesHalfWidth = confidenceHalfWidth(cell.movesVariance(), cell.completedIterations);
+			const double secondsHalfWidth = confidenceHalfWidth(cell.secondsVariance(), cell.timedIterations);
+
+			std::cout << "Avg moves: " << std::fixed << std::setprecision(2) << avg << " +- " << movesHalfWidth
+				<< ", avg seconds: " << std::setprecision(6) << cell.averageSeconds() << " +- " << secondsHalfWidth
+				<< " (95% CI, " << cell.completedIterations << " iterations"
+				<< (cell.timedIterations < cell.completedIterations ? ", seconds of " + std::to_string(cell.timedIterations) : "")
+				<< (adaptive && cell.completedIterations >= cellIterations ? ", precision not reached" : "") << ")\n";
+			reductionStats.print(std::cout);
+			decompositionStats.print(std::cout);
+			memoryStats.print(std::cout);
+			if (cache && trialCount > 0)
+			{
+				std::cout << cachedCount << " of " << trialCount << " solves from the cache, which only count towards the moves\n";
+			}
+
+			totalIterations += cell.completedIterations;
+
+			// Cells restored from the checkpoint were already written by the interrupted run.
+			if (output && !cellWasFinished)
+			{
+				output->writeCell(generator->getName(), graphSize, cell.completedIterations, avg, cell.averageSeconds(), movesHalfWidth, secondsHalfWidth);
+			}
+
+			results[generatorIt][graphSizeIt] = avg;
+			memoryResults[generatorIt][graphSizeIt] = memoryStats.peakBytesPerNode();
+
+			if (shardFile)
+			{
+				shardFile->cell(generator->getName(), graphSize) = cell;
+				try
+				{
+					shardFile->save();
+				}
+				catch (const std::exception& e)
+				{
+					std::cerr << e.what() << '\n';
+					exit(-1);
+				}
+			}
+		}
+	}
+
+	std::cout << "Total iterations: " << totalIterations << "\n";
+
+	std::vector<std::string> generatorNames;
+	for (auto&& generator : generators)
+	{
+		generatorNames.push_back(generator->getName());
+	}
+	writeResultTable(resultFilename, generatorNames, graphSizes, results);
+
+	// The peak bytes per node go to a table of their own, next to the moves.
+	if (tracksMemory)
+	{
+		std::experimental::filesystem::path memoryFilename = resultFilename;
+		memoryFilename.replace_filename(memoryFilename.stem().string() + "-memory" + memoryFilename.extension().string());
+		writeResultTable(memoryFilename.string(), generatorNames, graphSizes, memoryResults);
+	}
+}
+
+// Adds up the shard files of a sweep with a --seed into the result table of the whole sweep.
+// The averages and confidence intervals come out as if one process had run every trial.
+static void mergeShards(ArgMap args)
+{
+	requireArgument(args, "--merge");
+
+	const std::string resultFilename = args.find("--result") != args.cend() && !args["--result"].empty() ? args["--result"][0] : "result.csv";
+
+	Checkpoint::Cells cells;
+	std::string solver;
+	size_t iterations = 0;
+	Checkpoint::Shard firstShard;
+	Checkpoint::Sweep sweep;
+	std::vector<bool> mergedShards;
+
+	std::unique_ptr<ResultStream> output;
+	try
+	{
+		for (const std::string& filename : args["--merge"])
+		{
+			Checkpoint shardFile(filename, "", 0);
+			if (!shardFile.load())
+			{
+				throw std::runtime_error("Shard file " + filename + " not found");
+			}
+			else if (!shardFile.isSeeded())
+			{
+				throw std::runtime_error(filename + " was written by a sweep without a --seed");
+			}
+
+			const Checkpoint::Shard& shard = shardFile.shard();
+			if (mergedShards.empty())
+			{
+				solver = shardFile.solver();
+				iterations = shardFile.iterations();
+				firstShard = shard;
+				sweep = shardFile.sweep();
+				mergedShards.assign(shard.count, false);
+			}
+			else if (shardFile.solver() != solver || shardFile.iterations() != iterations || shard.seed != firstShard.seed || shard.count != firstShard.count
+				|| !(shardFile.sweep() == sweep))
+			{
+				throw std::runtime_error(filename + " belongs to another sweep than " + args["--merge"][0]);
+			}
+
+			if (mergedShards[shard.index])
+			{
+				throw std::runtime_error("Shard " + std::to_string(shard.index) + " was given twice");
+			}
+			mergedShards[shard.index] = true;
+
+			for (const auto& cell : shardFile.cells())
+			{
+				cells[cell.first].merge(cell.second);
+			}
+		}
+
+		if (args.find("--output") != args.cend())
+		{
+			requireArgument(args, "--output");
+			const std::string& outputFilename = args["--output"][0];
+			output = std::make_unique<ResultStream>(outputFilename, ResultStream::formatFromFilename(outputFilename));
+		}
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << '\n';
+		exit(-1);
+	}
+
+	for (size_t shardIt = 0; shardIt < mergedShards.size(); ++shardIt)
+	{
+		if (!mergedShards[shardIt])
+		{
+			std::cerr << "Shard " << shardIt << "/" << mergedShards.size() << " is missing.\n";
+		}
+	}
+
+	std::cout << "Solver: " << solver << " - Seed: " << firstShard.seed << " - Shards: " << firstShard.count << "\n";
+
+	// The shard files don't keep the order of the sweep, so the table is sorted.
+	std::vector<std::string> generatorNames;
+	std::vector<size_t> graphSizes;
+	for (const auto& cell : cells)
+	{
+		if (std::find(generatorNames.cbegin(), generatorNames.cend(), cell.first.first) == generatorNames.cend())
+		{
+			generatorNames.push_back(cell.first.first);
+		}
+		if (std::find(graphSizes.cbegin(), graphSizes.cend(), cell.first.second) == graphSizes.cend())
+		{
+			graphSizes.push_back(cell.first.second);
+		}
+	}
+	std::sort(graphSizes.begin(), graphSizes.end());
+
+	std::vector<std::vector<double>> results(generatorNames.size(), std::vector<double>(graphSizes.size()));
+	for (const auto& entry : cells)
+	{
+		const std::string& generatorName = entry.first.first;
+		const size_t graphSize = entry.first.second;
+		const CheckpointCell& cell = entry.second;
+
+		const double movesHalfWidth = confidenceHalfWidth(cell.movesVariance(), cell.completedIterations);
+		const double secondsHalfWidth = confidenceHalfWidth(cell.secondsVariance(), cell.timedIterations);
+
+		std::cout << "Generator: " << generatorName << " - Size: " << graphSize << "\n";
+		std::cout << "Avg moves: " << std::fixed << std::setprecision(2) << cell.averageMoves() << " +- " << movesHalfWidth
+			<< ", avg seconds: " << std::setprecision(6) << cell.averageSeconds() << " +- " << secondsHalfWidth
+			<< " (95% CI, " << cell.completedIterations << " iterations"
+			<< (cell.timedIterations < cell.completedIterations ? ", seconds of " + std::to_string(cell.timedIterations) : "")
+			<< (cell.completedIterations < iterations ? ", incomplete" : "") << ")\n";
+
+		if (output)
+		{
+			output->writeCell(generatorName, graphSize, cell.completedIterations, cell.averageMoves(), cell.averageSeconds(), movesHalfWidth, secondsHalfWidth);
+		}
+
+		const size_t generatorIt = std::find(generatorNames.cbegin(), generatorNames.cend(), generatorName) - generatorNames.cbegin();
+		const size_t graphSizeIt = std::find(graphSizes.cbegin(), graphSizes.cend(), graphSize) - graphSizes.cbegin();
+		results[generatorIt][graphSizeIt] = cell.averageMoves();
+	}
+
+	writeResultTable(resultFilename, generatorNames, graphSizes, results);
+}
+
+// Runs every solver on the same generated graphs. Each graph is generated once and solved
+// by all solvers in parallel, and only graphs that every solver manages to solve are
+// counted, so the per-graph results can be compared pairwise.
+static void compareSolvers(ArgMap args)
+{
+	requireArgument(args, "--solvers");
+	requireArgument(args, "--generators");
+	requireArgument(args, "--iterations");
+	requireArgument(args, "--graph-sizes");
+
+	const auto solvers = findSolvers(args["--solvers"]);
+	const auto generators = findGenerators(args["--generators"]);
+	const size_t iterations = parseIterations(args);
+	const std::vector<size_t> graphSizes = parseGraphSizes(args);
+	const auto valueRange = parseValueRange(args);
+	const bool reduce = args.find("--reduce") != args.cend();
+	const bool decompose = parseDecompose(args);
+	const bool tracksMemory = args.find("--track-memory") != args.cend();
+
+	const auto printSolverNames = [&solvers] ()
+	{
+		std::cout << "| ";
+		for (const auto& solver : solvers)
+		{
+			std::cout << solver->getName() << " | ";
+		}
+		std::cout << '\n';
+	};
+
+	std::random_device rd;
+	std::mt19937 r(rd());
+
+	GraphPipeline pipeline(makePipelineCells(generators, graphSizes), r, valueRange.first, valueRange.second, parsePipelineDepth(args), false);
+
+	// The solvers of a graph run at the same time, so every solver gets a share of the cores
+	// of its own, with a thread pool to match.
+	const size_t coreCount = std::max(std::thread::hardware_concurrency(), 1u);
+	if (solvers.size() > coreCount)
+	{
+		std::cout << "There are more solvers than cores, so some of them share a core.\n";
+	}
+
+	const size_t coresPerSolver = std::max<size_t>(coreCount / solvers.size(), 1);
+	std::vector<std::unique_ptr<SolverThread>> solverThreads;
+	for (size_t solverIt = 0; solverIt < solvers.size(); ++solverIt)
+	{
+		solverThreads.push_back(std::make_unique<SolverThread>(tracksMemory, coresPerSolver, solverIt * coresPerSolver % coreCount));
+	}
+	std::vector<SolveResult> solverResults(solvers.size());
+	GraphReduction reduction;
+	GraphDecomposition decomposition;
+	std::vector<int64_t> firings;
+
+	std::ofstream os("compare.csv");
+
+	os << "generator;size;iteration";
+	for (const auto& solver : solvers)
+	{
+		os << ';' << solver->getName();
+	}
+	for (size_t solverIt = 0; tracksMemory && solverIt < solvers.size(); ++solverIt)
+	{
+		os << ';' << solvers[solverIt]->getName() << " peak bytes";
+	}
+	os << '\n';
+
+	for (size_t generatorIt = 0; generatorIt < generators.size(); ++generatorIt)
+	{
+		const auto& generator = generators[generatorIt];
+		for (size_t graphSizeIt = 0; graphSizeIt < graphSizes.size(); ++graphSizeIt)
+		{
+			const size_t graphSize = graphSizes[graphSizeIt];
+			const size_t cellIndex = generatorIt * graphSizes.size() + graphSizeIt;
+
+			std::cout << "Generator: " << generator->getName() << " - Size: " << graphSize << "\n";
+
+			printSolverNames();
+
+			// samples[solverIt][iteration]
+			std::vector<std::vector<size_t>> samples(solvers.size());
+			std::vector<MemoryStats> memoryStats(solvers.size());
+			ReductionStats reductionStats;
+			DecompositionStats decompositionStats;
+
+			for (size_t iteration = 0; iteration < iterations; ++iteration)
+			{
+				while (true)
+				{
+					const Graph& graph = pipeline.next(cellIndex);
+
+					bool allSolversSucceeded = true;
+					if (reduce || decompose)
+					{
+						// Every solve has to wait for the reduced or block solves before it can
+						// expand or merge them, so the solvers take turns.
+						for (size_t solverIt = 0; solverIt < solvers.size(); ++solverIt)
+						{
+							const std::string tracePath = getTracePath(args, *solvers[solverIt], *generator, graphSize, iteration);
+							allSolversSucceeded &= reduce
+								? trySolveReduced(*solverThreads[solverIt], reduction, firings, graph, *solvers[solverIt], solverResults[solverIt], DefaultMoveLimit, tracePath)
+								: trySolveDecomposed(*solverThreads[solverIt], decomposition, firings, graph, *solvers[solverIt], solverResults[solverIt], DefaultMoveLimit, tracePath);
+						}
+					}
+					else
+					{
+						for (size_t solverIt = 0; solverIt < solvers.size(); ++solverIt)
+						{
+							const std::string tracePath = getTracePath(args, *solvers[solverIt], *generator, graphSize, iteration);
+							solverThreads[solverIt]->begin(*solvers[solverIt], graph, DefaultMoveLimit, tracePath);
+						}
+
+						for (size_t solverIt = 0; solverIt < solvers.size(); ++solverIt)
+						{
+							allSolversSucceeded &= solverThreads[solverIt]->end(solverResults[solverIt]);
+						}
+					}
+
+					if (allSolversSucceeded)
+					{
+						std::cout << "| ";
+						os << generator->getName() << ';' << graphSize << ';' << iteration;
+						for (size_t solverIt = 0; solverIt < solvers.size(); ++solverIt)
+						{
+							const size_t w = solvers[solverIt]->getName().length();
+							const size_t moveCount = solverResults[solverIt].moveCount;
+							std::cout << std::setw(w) << moveCount << " | ";
+							os << ';' << moveCount;
+
+							samples[solverIt].push_back(moveCount);
+							if (reduce)
+							{
+								reductionStats.add(graph, reduction, solverResults[solverIt]);
+							}
+							else if (decompose)
+							{
+								decompositionStats.add(graph, decomposition, solverResults[solverIt]);
+							}
+
+							if (tracksMemory)
+							{
+								memoryStats[solverIt].add(graph, solverResults[solverIt]);
+							}
+						}
+						for (size_t solverIt = 0; tracksMemory && solverIt < solvers.size(); ++solverIt)
+						{
+							os << ';' << solverResults[solverIt].allocations.peakBytes;
+						}
+						std::cout << '\n';
+						os << '\n';
+						break;
+					}
+				}
+			}
+
+			std::cout << "#\n";
+			std::cout << "# AVERAGE NUM MOVES\n";
+			std::cout << "#\n";
+
+			printSolverNames();
+
+			std::cout << "| ";
+			for (size_t solverIt = 0; solverIt < solvers.size(); ++solverIt)
+			{
+				const size_t w = solvers[solverIt]->getName().length();
+				const double total = (double)std::accumulate(samples[solverIt].cbegin(), samples[solverIt].cend(), size_t(0));
+				const double avg = total / (double)iterations;
+				std::cout << std::setw(w) << std::fixed << std::setprecision(2) << avg << " | ";
+			}
+			std::cout << '\n';
+
+			if (tracksMemory)
+			{
+				std::cout << "#\n";
+				std::cout << "# AVERAGE PEAK BYTES PER NODE\n";
+				std::cout << "#\n";
+
+				printSolverNames();
+
+				std::cout << "| ";
+				for (size_t solverIt = 0; solverIt < solvers.size(); ++solverIt)
+				{
+					const size_t w = solvers[solverIt]->getName().length();
+					std::cout << std::setw(w) << std::fixed << std::setprecision(2) << memoryStats[solverIt].peakBytesPerNode() << " | ";
+				}
+				std::cout << '\n';
+			}
+
+			reductionStats.print(std::cout);
+			decompositionStats.print(std::cout);
+
+			if (solvers.size() < 2 || iterations < 2)
+			{
+				continue;
+			}
+
+			// Since all solvers saw the same graphs, the per-graph differences to the first
+			// solver cancel out the variance between graphs.
+			std::cout << "#\n";
+			std::cout << "# PAIRED DIFFERENCE TO " << solvers[0]->getName() << " (MEAN +- STANDARD ERROR)\n";
+			std::cout << "#\n";
+
+			for (size_t solverIt = 1; solverIt < solvers.size(); ++solverIt)
+			{
+				double sum = 0.0;
+				double sumSquared = 0.0;
+				for (size_t iteration = 0; iteration < iterations; ++iteration)
+				{
+					const double diff = (double)samples[solverIt][iteration] - (double)samples[0][iteration];
+					sum += diff;
+					sumSquared += diff * diff;
+				}
+
+				const double n = (double)iterations;
+				const double mean = sum / n;
+				const double variance = std::max(0.0, (sumSquared - n * mean * mean) / (n - 1.0));
+				const double standardError = std::sqrt(variance / n);
+
+				std::cout << "  " << solvers[solverIt]->getName() << ": " << std::fixed << std::setprecision(2) << mean << " +- " << standardError << '\n';
+			}
+		}
+	}
+}
+
+// Races the solvers on every graph, each on a core of its own, and takes the moves of the
+// first to solve it. Every graph is also solved by every solver alone, on the same core,
+// for the latencies the portfolio is up against: those of the solver that is fastest on
+// average, and those of the one that is fastest on the graph, which no portfolio beats.
+// Latency is the time from the start of a race to the success of its winner, the copies
+// of the graph included. A solver that fails alone has an infinite latency on the graph,
+// which only counts as lost if the race has no winner either.
+static void racePortfolio(ArgMap args)
+{
+	requireArgument(args, "--portfolio");
+	requireArgument(args, "--generators");
+	requireArgument(args, "--iterations");
+	requireArgument(args, "--graph-sizes");
+
+	for (const char* option : { "--reduce", "--decompose", "--trace-moves", "--track-memory" })
+	{
+		if (args.find(option) != args.cend())
+		{
+			std::cerr << "The --portfolio can't be combined with " << option << ".\n";
+			exit(-1);
+		}
+	}
+
+	const auto solvers = findSolvers(args["--portfolio"]);
+	const auto generators = findGenerators(args["--generators"]);
+	const size_t iterations = parseIterations(args);
+	const std::vector<size_t> graphSizes = parseGraphSizes(args);
+	const auto valueRange = parseValueRange(args);
+
+	const size_t coreCount = std::max(std::thread::hardware_concurrency(), 1u);
+	if (solvers.size() > coreCount)
+	{
+		std::cout << "The portfolio has more solvers than there are cores, so some of them share a core.\n";
+	}
+
+	std::random_device rd;
+	std::mt19937 r(rd());
+
+	GraphPipeline pipeline(makePipelineCells(generators, graphSizes), r, valueRange.first, valueRange.second, parsePipelineDepth(args), false);
+
+	// Solvers run single-threaded, so that racing them doesn't take more cores than there
+	// are solvers.
+	SolverRace race;
+	std::vector<std::unique_ptr<SolverThread>> solverThreads;
+	for (size_t solverIt = 0; solverIt < solvers.size(); ++solverIt)
+	{
+		solverThreads.push_back(std::make_unique<SolverThread>(false, 1, solverIt % coreCount));
+		solverThreads[solverIt]->enterRace(&race, solverIt);
+	}
+	std::vector<SolveResult> solverResults(solvers.size());
+
+	// Starts the solvers in [firstSolver, lastSolver) on the graph and cancels the others
+	// once one of them solved it. Returns the winner, SIZE_MAX if every solver failed.
+	const auto runRace = [&] (const Graph& graph, size_t firstSolver, size_t lastSolver)
+	{
+		race.start(lastSolver - firstSolver);
+		for (size_t solverIt = firstSolver; solverIt < lastSolver; ++solverIt)
+		{
+			solverThreads[solverIt]->begin(*solvers[solverIt], graph, DefaultMoveLimit);
+		}
+
+		const size_t winner = race.wait();
+		for (size_t solverIt = firstSolver; solverIt < lastSolver; ++solverIt)
+		{
+			if (solverIt != winner)
+			{
+				solverThreads[solverIt]->cancel();
+			}
+		}
+
+		for (size_t solverIt = firstSolver; solverIt < lastSolver; ++solverIt)
+		{
+			solverThreads[solverIt]->end(solverResults[solverIt]);
+		}
+		return winner;
 	};
 
-	std::vector<std::pair<NodeValue, NodeValue>> valueRanges = {
-		{ -2, 2 },
+	const auto printNames = [&solvers] (const std::string& first, const std::string& last)
+	{
+		std::cout << "| " << first << " | ";
+		for (const auto& solver : solvers)
+		{
+			std::cout << solver->getName() << " | ";
+		}
+		std::cout << last << (last.empty() ? "\n" : " |\n");
 	};
 
-	std::random_device rd;
-	std::mt19937 r(rd());
+	std::ofstream os("portfolio.csv");
+
+	os << "generator;size;iteration;winner;moves;portfolio";
+	for (const auto& solver : solvers)
+	{
+		os << ';' << solver->getName();
+	}
+	os << '\n';
 
-	constexpr size_t moveLimit = 100000000;
+	const size_t winnerWidth = std::accumulate(solvers.cbegin(), solvers.cend(), std::strlen("winner"), [] (size_t width, const auto& solver) {
+		return std::max(width, solver->getName().length());
+	});
 
-	for (const size_t nodeCount : nodeCounts)
+	for (size_t generatorIt = 0; generatorIt < generators.size(); ++generatorIt)
 	{
-		std::cout << nodeCount << " nodes" << std::endl;
-		for (const auto& valueRange : valueRanges)
+		const auto& generator = generators[generatorIt];
+		for (size_t graphSizeIt = 0; graphSizeIt < graphSizes.size(); ++graphSizeIt)
 		{
-			std::cout << "values [" << valueRange.first << ", " << valueRange.second << "]" << std::endl;
+			const size_t graphSize = graphSizes[graphSizeIt];
+			const size_t cellIndex = generatorIt * graphSizes.size() + graphSizeIt;
 
-			std::cout << "| ";
-			for (size_t solverIt = 0; solverIt < solvers.size(); ++solverIt)
-			{
-				const size_t w = solvers[solverIt]->getName().length();
-				std::cout << std::setw(w) << solvers[solverIt]->getName() << " | ";
-			}
-			std::cout << '\n';
+			std::cout << "Generator: " << generator->getName() << " - Size: " << graphSize << "\n";
+			std::cout << "Latencies in milliseconds:\n";
+
+			printNames(std::string("winner") + std::string(winnerWidth - std::strlen("winner"), ' ') + " | portfolio", "");
 
-			std::vector<size_t> totalSolverMoves(solvers.size());
-			std::fill(totalSolverMoves.begin(), totalSolverMoves.end(), 0);
+			// Latencies in seconds, per iteration.
+			std::vector<double> portfolioLatencies;
+			std::vector<std::vector<double>> soloLatencies(solvers.size());
+			std::vector<double> bestLatencies;
+			std::vector<size_t> wins(solvers.size(), 0);
+			std::vector<size_t> failures(solvers.size(), 0);
+			size_t portfolioFailures = 0;
 
-			for (size_t sampleIt = 0; sampleIt < iterations; ++sampleIt)
+			for (size_t iteration = 0; iteration < iterations; ++iteration)
 			{
 				while (true)
 				{
-					Graph graph = generateGraph(generator, r, nodeCount);
-
-					std::vector<bool> solveSuccessful(solvers.size());
-					std::vector<size_t> solverMoves(solvers.size());
-					std::fill(solverMoves.begin(), solverMoves.end(), 0);
-
-					for (size_t solverIt = 0; solverIt < solvers.size(); ++solverIt)
+					const Graph& graph = pipeline.next(cellIndex);
+
+					// The race and the solo runs take turns at going first, so that neither
+					// gets a graph the other already brought into the cache every time.
+					const bool raceFirst = iteration % 2 == 0;
+					size_t winner = SIZE_MAX;
+					double latency = 0.0;
+					const auto runPortfolio = [&] ()
 					{
-						const GraphSolver& solver = *solvers[solverIt];
+						winner = runRace(graph, 0, solvers.size());
+						latency = race.latencySeconds();
+					};
 
-						//std::cout << "Solving with " << solver.getName() << '\n';
+					if (raceFirst)
+					{
+						runPortfolio();
+					}
 
-						std::vector<Move> moves;// = solverMoves[solverIt];
-						if (trySolve(graph, solver, moves, moveLimit))
-						{
-							//std::cout << "Solved in " << moves.size() << " moves by " << solver.getName() << '\n';
-							solveSuccessful[solverIt] = true;
-							solverMoves[solverIt] = moves.size();
-						}
-						else
-						{
-							//std::cout << "Could not be solved by " << solver.getName() << std::endl;
-							solveSuccessful[solverIt] = false;
-						}
+					// A solver that fails alone never solves the graph. The solo runs are
+					// skipped for graphs the race already failed on.
+					std::vector<double> latencies(solvers.size());
+					for (size_t solverIt = 0; solverIt < solvers.size() && (!raceFirst || winner != SIZE_MAX); ++solverIt)
+					{
+						const bool succeeded = runRace(graph, solverIt, solverIt + 1) == solverIt;
+						latencies[solverIt] = succeeded ? race.latencySeconds() : std::numeric_limits<double>::infinity();
 					}
 
-					const bool allSolversSucceeded = std::all_of(solveSuccessful.cbegin(), solveSuccessful.cend(), [] (bool b) { return b; });
-					if (allSolversSucceeded)
+					if (!raceFirst)
 					{
-						// Print results to console.
-						std::cout << "| ";
-						for (size_t solverIt = 0; solverIt < solvers.size(); ++solverIt)
-						{
-							const size_t w = solvers[solverIt]->getName().length();
-							std::cout << std::setw(w) << solverMoves[solverIt] << " | ";
+						runPortfolio();
+					}
 
-							totalSolverMoves[solverIt] += solverMoves[solverIt];
-						}
-						std::cout << '\n';
+					if (winner == SIZE_MAX)
+					{
+						++portfolioFailures;
+						continue;
+					}
 
-						//if (solverMoves[0] != solverMoves[1])
-						//{
-						//	__debugbreak();
-						//}
+					portfolioLatencies.push_back(latency);
+					bestLatencies.push_back(*std::min_element(latencies.cbegin(), latencies.cend()));
+					++wins[winner];
 
-						break;
+					std::cout << "| " << std::left << std::setw(winnerWidth) << solvers[winner]->getName() << std::right << " | "
+						<< std::setw(9) << std::fixed << std::setprecision(3) << 1000.0 * latency << " | ";
+					os << generator->getName() << ';' << graphSize << ';' << iteration << ';' << solvers[winner]->getName() << ';'
+						<< solverResults[winner].moveCount << ';' << latency;
+					for (size_t solverIt = 0; solverIt < solvers.size(); ++solverIt)
+					{
+						soloLatencies[solverIt].push_back(latencies[solverIt]);
+						failures[solverIt] += std::isinf(latencies[solverIt]) ? 1 : 0;
+						std::cout << std::setw(solvers[solverIt]->getName().length()) << 1000.0 * latencies[solverIt] << " | ";
+						os << ';' << latencies[solverIt];
 					}
+					std::cout << '\n';
+					os << '\n';
+					break;
 				}
 			}
 
 			std::cout << "#\n";
-			std::cout << "# AVERAGE NUM MOVES\n";
+			std::cout << "# WINS\n";
 			std::cout << "#\n";
 
-			std::cout << "| ";
+			printNames("portfolio", "");
+
+			std::cout << "| " << std::setw(std::strlen("portfolio")) << iterations << " | ";
 			for (size_t solverIt = 0; solverIt < solvers.size(); ++solverIt)
 			{
-				const size_t w = solvers[solverIt]->getName().length();
-				std::cout << std::setw(w) << solvers[solverIt]->getName() << " | ";
+				std::cout << std::setw(solvers[solverIt]->getName().length()) << wins[solverIt] << " | ";
 			}
 			std::cout << '\n';
 
-			std::cout << "| ";
+			if (portfolioFailures > 0 || std::any_of(failures.cbegin(), failures.cend(), [] (size_t count) { return count > 0; }))
+			{
+				std::cout << "#\n";
+				std::cout << "# FAILURES (THE GRAPHS THE PORTFOLIO FAILED ON WERE REPLACED)\n";
+				std::cout << "#\n";
+
+				printNames("portfolio", "");
+
+				std::cout << "| " << std::setw(std::strlen("portfolio")) << portfolioFailures << " | ";
+				for (size_t solverIt = 0; solverIt < solvers.size(); ++solverIt)
+				{
+					std::cout << std::setw(solvers[solverIt]->getName().length()) << failures[solverIt] << " | ";
+				}
+				std::cout << '\n';
+			}
+
+			// The solver with the lowest mean latency, which is what running a single solver
+			// would have picked. Only solvers that solved every graph alone qualify.
+			size_t bestSolverIt = SIZE_MAX;
 			for (size_t solverIt = 0; solverIt < solvers.size(); ++solverIt)
 			{
-				const size_t w = solvers[solverIt]->getName().length();
-				const double avg = (double)totalSolverMoves[solverIt] / iterations;
-				std::cout << std::setw(w) << std::fixed << std::setprecision(2) << avg << " | ";
+				if (failures[solverIt] == 0 && (bestSolverIt == SIZE_MAX || mean(soloLatencies[solverIt]) < mean(soloLatencies[bestSolverIt])))
+				{
+					bestSolverIt = solverIt;
+				}
 			}
-			std::cout << '\n';
-		}
-	}
-}
 
-static void printSolvers()
-{
-	const auto solvers = enumSolvers();
+			const auto printLatencies = [&] (const char* title, const auto& statistic)
+			{
+				std::cout << "#\n";
+				std::cout << "# " << title << " LATENCY (MS)\n";
+				std::cout << "#\n";
 
-	size_t maxNameLength = 0;
-	for (auto&& solver : solvers)
-	{
-		maxNameLength = std::max(maxNameLength, solver->getName().length());
-	}
+				printNames("portfolio", "best per graph");
 
-	std::cout << "\nSolvers available:\n\n";
-	for (auto&& solver : solvers)
-	{
-		std::cout << "  " << std::setw(maxNameLength) << solver->getName() << " - " << solver->getDescription() << '\n';
-	}
-}
+				std::cout << "| " << std::setw(std::strlen("portfolio")) << std::fixed << std::setprecision(3) << 1000.0 * statistic(portfolioLatencies) << " | ";
+				for (size_t solverIt = 0; solverIt < solvers.size(); ++solverIt)
+				{
+					std::cout << std::setw(solvers[solverIt]->getName().length()) << 1000.0 * statistic(soloLatencies[solverIt]) << " | ";
+				}
+				std::cout << std::setw(std::strlen("best per graph")) << 1000.0 * statistic(bestLatencies) << " |\n";
+			};
+			printLatencies("MEAN", mean);
+			printLatencies("MEDIAN", median);
 
-static void printGenerators()
-{
-	const auto generators = enumGenerators();
+			if (bestSolverIt == SIZE_MAX)
+			{
+				std::cout << "No single solver solved every graph, so only the portfolio has a finite mean latency.\n";
+				continue;
+			}
 
-	size_t maxNameLength = 0;
-	for (auto&& generator : generators)
-	{
-		maxNameLength = std::max(maxNameLength, generator->getName().length());
-	}
+			size_t fasterCount = 0;
+			for (size_t iteration = 0; iteration < iterations; ++iteration)
+			{
+				fasterCount += portfolioLatencies[iteration] < soloLatencies[bestSolverIt][iteration] ? 1 : 0;
+			}
 
-	std::cout << "\nGenerators available:\n\n";
-	for (auto&& generator : generators)
-	{
-		std::cout << "  " << std::setw(maxNameLength) << generator->getName() << " - " << generator->getDescription() << '\n';
+			const auto& bestSolverLatencies = soloLatencies[bestSolverIt];
+			std::cout << "Speedup over " << solvers[bestSolverIt]->getName() << ", the fastest single solver: "
+				<< std::fixed << std::setprecision(2) << mean(bestSolverLatencies) / mean(portfolioLatencies) << "x in mean latency, "
+				<< median(bestSolverLatencies) / median(portfolioLatencies) << "x in median latency, faster on "
+				<< std::setprecision(1) << 100.0 * (double)fasterCount / (double)iterations << "% of the graphs\n";
+		}
 	}
 }
 
-static void printUsage()
+static uint32_t getRegressionSeed(const std::string& generatorName, size_t graphSize, size_t trial)
 {
-	std::cout << "Usage:\n\n";
-	std::cout << "  DollarGame <options>\n\n";
-	std::cout << "Options:\n\n";
-	const size_t w = 12;
-	std::cout << "  --solvers   "  << std::setw(w) << "<solvers>" << " - Specify which solvers to run.\n";
-	std::cout << "  --generator "  << std::setw(w) << "<generator>" << " - Specify which generator should be used to generate graphs.\n";
-	std::cout << "  --graph-size"  << std::setw(w) << "N" << " - Size of the graphs.\n";
-	std::cout << "  --iterations"  << std::setw(w) << "N" << " - Number of iterations to run.\n";
-	std::cout << '\n';
-
-	printSolvers();
-
-	printGenerators();
+	const uint64_t hash = hashTrialKey(generatorName, graphSize, trial);
+	return (uint32_t)(hash ^ (hash >> 32));
 }
 
-static void benchmarkSolver(std::map<std::string, std::vector<std::string>> args)
+// Solves a fixed set of graphs with every solver and records solve times and move counts.
+// The samples can be stored as a baseline, or compared against a stored baseline, in which
+// case the process exits with a non-zero code if any cell regressed.
+static void runRegression(ArgMap args)
 {
-	if (args.find("--solver") == args.cend())
+	// Some solvers never finish on some graphs, and every such solve would burn the second
+	// of the watchdog, so the solvers of the matrix have to be named.
+	if (args.find("--solvers") == args.cend() || args["--solvers"].empty())
 	{
-		std::cerr << "Missing argument: --solver\n";
-		std::exit(-1);
+		std::cerr << "The --record-baseline and --check-baseline require --solvers.\n";
+		exit(-1);
 	}
 
-	if (args.find("--generators") == args.cend())
-	{
-		std::cerr << "Missing argument: --generators\n";
-		std::exit(-1);
-	}
+	const auto solvers = findSolvers(args["--solvers"]);
+	const auto generators = args.find("--generators") != args.cend() ? findGenerators(args["--generators"]) : enumGenerators();
+	const size_t iterations = args.find("--iterations") != args.cend() ? parseIterations(args) : 10;
+	const std::vector<size_t> graphSizes = args.find("--graph-sizes") != args.cend() ? parseGraphSizes(args) : std::vector<size_t>{ 100, 1000 };
 
-	if (args.find("--iterations") == args.cend())
-	{
-		std::cerr << "Missing argument: --iterations\n";
-		std::exit(-1);
-	}
+	// Uniform graphs have a genus of about V, which the usual [-2, 3] values almost never
+	// reach on large graphs, so the default matrix uses a range every generator can satisfy.
+	const auto valueRange = args.find("--value-range") != args.cend() ? parseValueRange(args) : std::pair<NodeValue, NodeValue>{ -2, 5 };
 
-	if (args.find("--graph-sizes") == args.cend())
+	double threshold = 0.1;
+	if (args.find("--threshold") != args.cend())
 	{
-		std::cerr << "Missing argument: --graph-sizes\n";
-		std::exit(-1);
+		try
+		{
+			threshold = std::stod(args["--threshold"].at(0)) / 100.0;
+		}
+		catch (const std::exception&)
+		{
+			std::cerr << "The --threshold must be a percentage.\n";
+			exit(-1);
+		}
 	}
 
-	const auto& argSolver = args["--solver"][0];
-	const auto& argGenerators = args["--generators"];
-	const auto& argIterations = args["--iterations"][0];
-	const auto& argGraphSizes = args["--graph-sizes"];
+	std::vector<RegressionSample> samples;
 
-	std::unique_ptr<GraphSolver> solver;
-	std::vector<std::unique_ptr<GraphGenerator>> generators;
-	size_t iterations;
-	std::vector<size_t> graphSizes;
+	ThreadPool threadPool;
+	GeneratorWorkspace generatorWorkspace(&threadPool);
+	Graph graph;
+	SolverThread solverThread;
 
+	for (const auto& generator : generators)
 	{
-		auto allSolvers = enumSolvers();
-		for (auto&& s : allSolvers)
+		for (const size_t graphSize : graphSizes)
 		{
-			if (s->getName() == argSolver)
+			std::cout << "Generator: " << generator->getName() << " - Size: " << graphSize << "\n";
+
+			for (size_t trial = 0; trial < iterations; ++trial)
 			{
-				solver = std::move(s);
-				break;
+				std::mt19937 r(getRegressionSeed(generator->getName(), graphSize, trial));
+				generateGraph(*generator, generatorWorkspace, r, graphSize, valueRange.first, valueRange.second, graph);
+
+				for (const auto& solver : solvers)
+				{
+					SolveResult result;
+					const bool solved = trySolve(solverThread, graph, *solver, result, DefaultMoveLimit);
+
+					RegressionSample sample;
+					sample.solver = solver->getName();
+					sample.generator = generator->getName();
+					sample.graphSize = graphSize;
+					sample.trial = trial;
+					sample.solved = solved;
+					sample.seconds = result.solveSeconds;
+					sample.moveCount = result.moveCount;
+					samples.push_back(sample);
+				}
 			}
 		}
 	}
 
+	try
 	{
-		auto allGenerators = enumGenerators();
-		for (const auto& argGenerator : argGenerators)
+		if (args.find("--record-baseline") != args.cend())
 		{
-			bool foundGenerator = false;
-			for (auto&& generator : allGenerators)
-			{
-				if (generator && generator->getName() == argGenerator)
-				{
-					generators.push_back(std::move(generator));
-					foundGenerator = true;
-					break;
-				}
-			}
+			writeBaseline(args["--record-baseline"].at(0), samples);
+		}
 
-			if (!foundGenerator)
+		if (args.find("--check-baseline") != args.cend())
+		{
+			const auto baseline = readBaseline(args["--check-baseline"].at(0));
+
+			std::cout << '\n';
+			const size_t regressionCount = compareToBaseline(baseline, samples, threshold, 0.05, std::cout);
+			if (regressionCount > 0)
 			{
-				std::cerr << "Generator \"" << argGenerator << "\" not found.\n";
-				exit(-1);
+				std::cout << '\n' << regressionCount << " regression(s) beyond " << threshold * 100.0 << "%.\n";
+				exit(1);
 			}
 		}
 	}
-
-	try
-	{
-		iterations = std::stoull(argIterations);
-	}
-	catch (const std::exception&)
+	catch (const std::out_of_range&)
 	{
-		std::cerr << "The --iterations must be a positive integer.\n";
+		std::cerr << "The --record-baseline and --check-baseline must be followed by a file.\n";
 		exit(-1);
 	}
-
-	try
-	{
-		for (const auto& argGraphSize : argGraphSizes)
-		{
-			graphSizes.push_back(std::stoull(argGraphSize));
-		}
-	}
-	catch (const std::exception&)
+	catch (const std::exception& e)
 	{
-		std::cerr << "The --graph-sizes must be positive integers.\n";
+		std::cerr << e.what() << '\n';
 		exit(-1);
 	}
+}
 
-	std::vector<std::vector<double>> results;
-	results.resize(generators.size());
-	for (auto&& result : results)
+// The plain adjacency-list loop that the Laplacian kernels are measured against.
+static void applyLaplacianCsr(const GraphTopology& topology, const double* x, double* y)
+{
+	for (NodeHandle node = 0; node < topology.size(); ++node)
 	{
-		result.resize(graphSizes.size());
+		double sum = 0.0;
+		const size_t degree = topology.forEachConnection(node, [x, &sum] (NodeHandle connection) {
+			sum += x[connection];
+		});
+		y[node] = (double)degree * x[node] - sum;
 	}
+}
+
+// Times L·x with every Laplacian kernel this CPU supports against the adjacency-list loop,
+// and L·X for a batch of vectors, on generated graphs.
+static void benchmarkLaplacian(ArgMap args)
+{
+	requireArgument(args, "--generators");
+	requireArgument(args, "--graph-sizes");
+
+	const auto generators = findGenerators(args["--generators"]);
+	const std::vector<size_t> graphSizes = parseGraphSizes(args);
+	const size_t iterations = args.find("--iterations") != args.cend() ? parseIterations(args) : 100;
+	const auto valueRange = parseValueRange(args);
+	const size_t batchSize = 8;
 
 	std::random_device rd;
 	std::mt19937 r(rd());
 
-	for (size_t generatorIt = 0; generatorIt < generators.size(); ++generatorIt)
+	ThreadPool threadPool;
+	GeneratorWorkspace generatorWorkspace(&threadPool);
+	Graph graph;
+
+	std::vector<double> x;
+	std::vector<double> expected;
+	std::vector<double> y;
+	std::vector<double> batchVector;
+
+	// Nanoseconds per nonzero of the Laplacian for one product.
+	const auto timeProduct = [iterations] (size_t nonzeroCount, const auto& product)
 	{
-		const auto& generator = generators[generatorIt];
-		for (size_t graphSizeIt = 0; graphSizeIt < graphSizes.size(); ++graphSizeIt)
+		const auto begin = std::chrono::steady_clock::now();
+		for (size_t iteration = 0; iteration < iterations; ++iteration)
 		{
-			const size_t graphSize = graphSizes[graphSizeIt];
+			product();
+		}
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+		return 1e9 * seconds / (double)(iterations * nonzeroCount);
+	};
 
-			size_t totalSolverMoves = 0;
+	const auto maxDeviation = [&expected, &y] ()
+	{
+		double deviation = 0.0;
+		for (size_t i = 0; i < expected.size(); ++i)
+		{
+			deviation = std::max(deviation, std::abs(expected[i] - y[i]));
+		}
+		return deviation;
+	};
 
+	for (const auto& generator : generators)
+	{
+		for (const size_t graphSize : graphSizes)
+		{
 			std::cout << "Generator: " << generator->getName() << " - Size: " << graphSize << "\n";
 
-			for (size_t iteration = 0; iteration < iterations; ++iteration)
-			{
-				while (true)
-				{
-					Graph graph = generateGraph(*generator, r, graphSize);
+			generateGraph(*generator, generatorWorkspace, r, graphSize, valueRange.first, valueRange.second, graph);
+			const GraphTopology& topology = graph.topology();
+			const size_t nonzeroCount = graph.size() + 2 * topology.edgeCount();
 
-					bool solveSuccessful;
+			const auto buildBegin = std::chrono::steady_clock::now();
+			const Laplacian laplacian(topology);
+			const double buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - buildBegin).count();
 
-					std::vector<Move> moves;
-					if (trySolve(graph, *solver, moves, 1000000))
-					{
-						solveSuccessful = true;
-					}
-					else
-					{
-						solveSuccessful = false;
-					}
+			std::cout << "SELL-" << Laplacian::ChunkSize << "-" << Laplacian::SortWindow << " built in " << std::fixed << std::setprecision(3)
+				<< 1e3 * buildSeconds << " ms, " << std::setprecision(2) << laplacian.fillRatio() << " stored entries per nonzero\n";
 
-					if (solveSuccessful)
-					{
-						totalSolverMoves += moves.size();
-						break;
-					}
-				}
+			std::uniform_real_distribution<double> valueDist(-1.0, 1.0);
+			x.resize(graph.size() * batchSize);
+			for (double& value : x)
+			{
+				value = valueDist(r);
 			}
 
-			const double avg = (double)totalSolverMoves / (double)iterations;
+			expected.resize(graph.size());
+			y.resize(graph.size());
+			const double csrTime = timeProduct(nonzeroCount, [&] { applyLaplacianCsr(topology, x.data(), expected.data()); });
+			std::cout << "  " << std::left << std::setw(12) << "CSR" << std::right << std::setprecision(3) << csrTime << " ns per nonzero\n";
 
-			std::cout << "Avg moves: " << std::fixed << std::setprecision(2) << avg << "\n";
+			for (const Laplacian::Kernel kernel : { Laplacian::Kernel::Scalar, Laplacian::Kernel::Avx2, Laplacian::Kernel::Avx512 })
+			{
+				std::cout << "  " << std::left << std::setw(12) << Laplacian::kernelName(kernel) << std::right;
+				if (kernel > Laplacian::bestKernel())
+				{
+					std::cout << "not supported by this CPU\n";
+					continue;
+				}
 
-			results[generatorIt][graphSizeIt] = avg;
-		}
-	}
+				std::fill(y.begin(), y.end(), 0.0);
+				const double time = timeProduct(nonzeroCount, [&] { laplacian.apply(x.data(), y.data(), kernel); });
+				std::cout << time << " ns per nonzero, " << csrTime / time << "x, max deviation " << std::scientific << maxDeviation() << std::fixed << "\n";
+			}
 
-	std::ofstream os("result.csv");
-	
-	for (auto&& generator : generators)
-	{
-		os << ';' << generator->getName();
-	}
-	os << '\n';
+			// Checked against the CSR loop, one vector of the batch at a time.
+			y.resize(graph.size() * batchSize);
+			const double batchTime = timeProduct(nonzeroCount * batchSize, [&] { laplacian.applyBatch(x.data(), y.data(), batchSize); });
 
-	for (size_t graphSizeIt = 0; graphSizeIt < graphSizes.size(); ++graphSizeIt)
-	{
-		os << graphSizes[graphSizeIt];
-		for (size_t generatorIt = 0; generatorIt < generators.size(); ++generatorIt)
-		{
-			os << ';' << results[generatorIt][graphSizeIt];
+			double batchDeviation = 0.0;
+			batchVector.resize(graph.size());
+			for (size_t vectorIt = 0; vectorIt < batchSize; ++vectorIt)
+			{
+				for (size_t node = 0; node < graph.size(); ++node)
+				{
+					batchVector[node] = x[node * batchSize + vectorIt];
+				}
+				applyLaplacianCsr(topology, batchVector.data(), expected.data());
+				for (size_t node = 0; node < graph.size(); ++node)
+				{
+					batchDeviation = std::max(batchDeviation, std::abs(expected[node] - y[node * batchSize + vectorIt]));
+				}
+			}
+			std::cout << "  " << std::left << std::setw(12) << ("Batch of " + std::to_string(batchSize)) << std::right << batchTime
+				<< " ns per nonzero and vector, " << csrTime / batchTime << "x, max deviation " << std::scientific << batchDeviation << std::fixed << "\n";
 		}
-		os << '\n';
 	}
 }
 
@@ -492,7 +2488,9 @@ int main(int argc, char* argv[])
 	{
 		if (strlen(argv[i]) >= 2 && argv[i][0] == '-' && argv[i][1] == '-')
 		{
+			// Flags without values still get an entry, so that they can be looked up.
 			lastArgName = argv[i];
+			args[lastArgName];
 			continue;
 		}
 		else
@@ -501,7 +2499,68 @@ int main(int argc, char* argv[])
 		}
 	}
 
-	benchmarkSolver(args);
+	const auto traceIt = args.find("--trace");
+	if (traceIt != args.cend())
+	{
+		if (traceIt->second.empty())
+		{
+			std::cerr << "The --trace must be followed by an output file.\n";
+			exit(-1);
+		}
+
+		TimelineRecorder::enable();
+		TimelineRecorder::active()->setThreadName("main");
+	}
+
+	if (args.find("--huge-pages") != args.cend())
+	{
+		// The solver and generator modules read the switch from the environment too.
+#if _WIN32
+		_putenv_s(HugePagesVariable, "1");
+#elif __linux__
+		setenv(HugePagesVariable, "1", 1);
+#endif
+	}
+
+	// Generators report graphs they can't build by throwing, from wherever a mode asks for
+	// its next graph.
+	try
+	{
+		if (args.find("--record-baseline") != args.cend() || args.find("--check-baseline") != args.cend())
+		{
+			runRegression(args);
+		}
+		else if (args.find("--merge") != args.cend())
+		{
+			mergeShards(args);
+		}
+		else if (args.find("--laplacian-benchmark") != args.cend())
+		{
+			benchmarkLaplacian(args);
+		}
+		else if (args.find("--portfolio") != args.cend())
+		{
+			racePortfolio(args);
+		}
+		else if (args.find("--solvers") != args.cend())
+		{
+			compareSolvers(args);
+		}
+		else
+		{
+			benchmarkSolver(args);
+		}
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << '\n';
+		exit(-1);
+	}
+
+	if (TimelineRecorder::active())
+	{
+		TimelineRecorder::active()->write(traceIt->second[0]);
+	}
 
     return 0;
 }
@@ -0,0 +1,132 @@
+#include "MoveTrace.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <string>
+
+static void printUsage()
+{
+	std::cout << "Usage:\n\n";
+	std::cout << "  DollarTrace <trace>                        - Replay a move trace and print statistics.\n";
+	std::cout << "  DollarTrace <trace> --dump [first] [count] - Print the moves of a move trace.\n";
+}
+
+static void dumpMoves(const MoveTraceReader& trace, size_t first, size_t count)
+{
+	const auto moves = trace.moves();
+	const size_t last = std::min(moves.size(), first + count);
+	for (size_t moveIt = first; moveIt < last; ++moveIt)
+	{
+		const uint32_t record = moves[moveIt];
+		std::cout << moveIt << ' ' << (decodeTraceMoveType(record) ? "take " : "give ") << decodeTraceMoveNode(record) << '\n';
+	}
+}
+
+static void replay(const MoveTraceReader& trace)
+{
+	Graph graph;
+	trace.initGraph(graph);
+
+	const auto moves = trace.moves();
+
+	std::vector<size_t> gives(graph.size());
+	std::vector<size_t> takes(graph.size());
+
+	for (const uint32_t record : moves)
+	{
+		const NodeHandle node = decodeTraceMoveNode(record);
+		if (node >= graph.size())
+		{
+			std::cerr << "Move on invalid node " << node << '\n';
+			exit(-1);
+		}
+
+		if (decodeTraceMoveType(record))
+		{
+			graph.take(node);
+			++takes[node];
+		}
+		else
+		{
+			graph.give(node);
+			++gives[node];
+		}
+	}
+
+	size_t totalGives = 0;
+	size_t totalTakes = 0;
+	for (size_t nodeIt = 0; nodeIt < graph.size(); ++nodeIt)
+	{
+		totalGives += gives[nodeIt];
+		totalTakes += takes[nodeIt];
+	}
+
+	const auto minIt = std::min_element(graph.values().cbegin(), graph.values().cend());
+
+	std::cout << "Nodes:       " << trace.nodeCount() << '\n';
+	std::cout << "Edges:       " << trace.edgeCount() << '\n';
+	std::cout << "Moves:       " << trace.moveCount() << (trace.isFinished() ? "" : " (trace was not closed)") << '\n';
+	std::cout << "Gives:       " << totalGives << '\n';
+	std::cout << "Takes:       " << totalTakes << '\n';
+	std::cout << "Final state: " << (graph.isSolved() ? "solved" : "unsolved");
+	if (minIt != graph.values().cend())
+	{
+		std::cout << " (min value " << *minIt << ')';
+	}
+	std::cout << '\n';
+
+	std::vector<NodeHandle> nodes(graph.size());
+	for (NodeHandle nodeIt = 0; nodeIt < graph.size(); ++nodeIt)
+	{
+		nodes[nodeIt] = nodeIt;
+	}
+
+	const size_t topCount = std::min<size_t>(10, nodes.size());
+	std::partial_sort(nodes.begin(), nodes.begin() + topCount, nodes.end(), [&] (NodeHandle a, NodeHandle b) {
+		return gives[a] + takes[a] > gives[b] + takes[b];
+	});
+
+	std::cout << "\nMost active nodes:\n\n";
+	std::cout << std::setw(12) << "node" << std::setw(12) << "degree" << std::setw(12) << "gives" << std::setw(12) << "takes" << '\n';
+	for (size_t nodeIt = 0; nodeIt < topCount; ++nodeIt)
+	{
+		const NodeHandle node = nodes[nodeIt];
+		std::cout << std::setw(12) << node
+			<< std::setw(12) << graph.getNodeConnections(node).size()
+			<< std::setw(12) << gives[node]
+			<< std::setw(12) << takes[node] << '\n';
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		printUsage();
+		exit(-1);
+	}
+
+	try
+	{
+		MoveTraceReader trace(argv[1]);
+
+		if (argc >= 3 && strcmp(argv[2], "--dump") == 0)
+		{
+			const size_t first = argc >= 4 ? std::stoull(argv[3]) : 0;
+			const size_t count = argc >= 5 ? std::stoull(argv[4]) : trace.moveCount();
+			dumpMoves(trace, first, count);
+		}
+		else
+		{
+			replay(trace);
+		}
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << '\n';
+		exit(-1);
+	}
+
+	return 0;
+}
\ No newline at end of file
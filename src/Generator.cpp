@@ -1,11 +1,11 @@
 #include "Generator.hpp"
 
 GraphGenerator::GraphGenerator(const std::string& dllName)
-	: m_dll(dllName)
+	: m_dll(std::make_unique<DllHandle>(dllName))
 {
-	m_fnGetName = m_dll.getProcAddress<FnGetName>("GENERATOR_getName");
-	m_fnGetDescription = m_dll.getProcAddress<FnGetDescription>("GENERATOR_getDescription");
-	m_fnGenerate = m_dll.getProcAddress<FnGenerate>("GENERATOR_generate");
+	m_fnGetName = m_dll->getProcAddress<FnGetName>("GENERATOR_getName");
+	m_fnGetDescription = m_dll->getProcAddress<FnGetDescription>("GENERATOR_getDescription");
+	m_fnGenerate = m_dll->getProcAddress<FnGenerate>("GENERATOR_generate");
 
 	if (m_fnGetName == nullptr)
 	{
@@ -23,6 +23,15 @@ GraphGenerator::GraphGenerator(const std::string& dllName)
 	}
 }
 
+#if DOLLARGAME_MONOLITHIC
+GraphGenerator::GraphGenerator(const StaticGenerator& generator)
+	: m_fnGetName(generator.getName)
+	, m_fnGetDescription(generator.getDescription)
+	, m_fnGenerate(generator.generate)
+{
+}
+#endif
+
 std::string GraphGenerator::getName() const
 {
 	assert(m_fnGetName);
@@ -10,7 +10,8 @@ private:
 	typedef const char* (FnGetDescription)();
 	typedef void (FnGenerate)(GeneratorContext&, const GeneratorParams&);
 
-	DllHandle m_dll;
+	// Null for generators compiled into the executable.
+	std::unique_ptr<DllHandle> m_dll;
 
 	FnGetName* m_fnGetName;
 	FnGetDescription* m_fnGetDescription;
@@ -18,6 +19,9 @@ private:
 
 public:
 	GraphGenerator(const std::string& dllName);
+#if DOLLARGAME_MONOLITHIC
+	GraphGenerator(const StaticGenerator& generator);
+#endif
 	GraphGenerator(const GraphGenerator&) = delete;
 
 	std::string getName() const;
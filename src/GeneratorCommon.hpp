@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Graph.hpp"
+#include "CounterRandom.hpp"
 
 #include <random>
 
@@ -10,25 +11,137 @@
 #define DLLEXPORT __attribute__((visibility("default")))
 #endif
 
+#if DOLLARGAME_MONOLITHIC
+
+// See SOLVER_FUNC in SolverCommon.hpp.
+class GeneratorContext;
+class GeneratorParams;
+
+struct StaticGenerator
+{
+	const char* (*getName)();
+	const char* (*getDescription)();
+	void (*generate)(GeneratorContext&, const GeneratorParams&);
+};
+
+inline std::vector<StaticGenerator>& staticGenerators()
+{
+	static std::vector<StaticGenerator> generators;
+	return generators;
+}
+
+struct StaticGeneratorRegistrar
+{
+	StaticGeneratorRegistrar(const StaticGenerator& generator)
+	{
+		staticGenerators().push_back(generator);
+	}
+};
+
+#define GENERATOR_NAME(Name) static const char* GENERATOR_getName() { return Name; }
+#define GENERATOR_DESCRIPTION(Description) static const char* GENERATOR_getDescription() { return Description; }
+#define GENERATOR_FUNC \
+	static void GENERATOR_generate(GeneratorContext&, const GeneratorParams&); \
+	static const StaticGeneratorRegistrar generatorRegistrar({ &GENERATOR_getName, &GENERATOR_getDescription, &GENERATOR_generate }); \
+	static void GENERATOR_generate
+
+#else
+
 #define GENERATOR_NAME(Name) extern "C" DLLEXPORT const char* GENERATOR_getName() { return Name; }
 #define GENERATOR_DESCRIPTION(Description) extern "C" DLLEXPORT const char* GENERATOR_getDescription() { return Description; }
 #define GENERATOR_FUNC extern "C" DLLEXPORT void GENERATOR_generate
 
+#endif
+
+// Open addressing set of edges, for generators that must not add an edge twice. Unlike a
+// std::set it stops allocating once it has grown to the largest graph.
+class EdgeSet final
+{
+private:
+	static constexpr uint64_t EmptySlot = std::numeric_limits<uint64_t>::max();
+
+	std::vector<uint64_t> m_slots;
+	size_t m_mask = 0;
+
+public:
+	// Empties the set and makes room for edgeCount edges.
+	void reset(size_t edgeCount)
+	{
+		size_t slotCount = 16;
+		while (slotCount < edgeCount * 2)
+		{
+			slotCount *= 2;
+		}
+		m_slots.assign(slotCount, EmptySlot);
+		m_mask = slotCount - 1;
+	}
+
+	// Returns false if the edge was already in the set, in either direction.
+	bool insert(const Edge& edge)
+	{
+		const uint64_t key = ((uint64_t)std::min(edge.a, edge.b) << 32) | std::max(edge.a, edge.b);
+		for (size_t slot = (size_t)((key * 0x9e3779b97f4a7c15ull) >> 32) & m_mask; ; slot = (slot + 1) & m_mask)
+		{
+			if (m_slots[slot] == key)
+			{
+				return false;
+			}
+			else if (m_slots[slot] == EmptySlot)
+			{
+				m_slots[slot] = key;
+				return true;
+			}
+		}
+	}
+};
+
+// Buffers that generators reuse from one graph to the next. The harness keeps one per
+// worker, so that generating graphs of sizes seen before doesn't allocate.
+class GeneratorWorkspace final
+{
+private:
+	friend class GeneratorContext;
+
+	std::vector<NodeValue> m_values;
+	std::vector<NodeHandle> m_handles;
+	std::vector<Edge> m_edges;
+	EdgeSet m_edgeSet;
+	TopologyPool m_topologies;
+	ThreadPool* m_threadPool;
+
+public:
+	GeneratorWorkspace(ThreadPool* threadPool = nullptr)
+		: m_threadPool(threadPool)
+	{
+	}
+
+	GeneratorWorkspace(const GeneratorWorkspace&) = delete;
+};
+
 class GeneratorContext final
 {
 private:
 	Graph& m_graph;
 	std::mt19937& m_random;
+	GeneratorWorkspace& m_workspace;
 
 public:
-	GeneratorContext(Graph& graph, std::mt19937& random)
+	GeneratorContext(Graph& graph, std::mt19937& random, GeneratorWorkspace& workspace)
 		: m_graph(graph)
 		, m_random(random)
+		, m_workspace(workspace)
 	{
 	}
 
 	GeneratorContext(const GeneratorContext&) = delete;
 
+	// Key for a CounterRandom stream, so that the bulk fills follow the seed of random().
+	uint64_t drawKey()
+	{
+		const uint64_t high = m_random();
+		return (high << 32) | m_random();
+	}
+
 	__forceinline Graph& graph()
 	{
 		return m_graph;
@@ -38,6 +151,61 @@ public:
 	{
 		return m_random;
 	}
+
+	// Scratch buffer for the node values, resized to count. Its old contents are undefined.
+	__forceinline std::vector<NodeValue>& values(size_t count)
+	{
+		m_workspace.m_values.resize(count);
+		return m_workspace.m_values;
+	}
+
+	// Scratch buffer for node handles, such as edge endpoints, resized to count. Its old
+	// contents are undefined.
+	__forceinline std::vector<NodeHandle>& handles(size_t count)
+	{
+		m_workspace.m_handles.resize(count);
+		return m_workspace.m_handles;
+	}
+
+	// Fills the values with numbers uniformly distributed in [minValue, maxValue], in
+	// parallel for large graphs. They follow from the state of random() alone, whatever the
+	// number of threads, and leave it as two draws would.
+	void fillUniformValues(Range<NodeValue> values, NodeValue minValue, NodeValue maxValue)
+	{
+		CounterRandom(drawKey()).fillUniformValues(values, minValue, maxValue, threadPool());
+	}
+
+	// Like fillUniformValues, for handles in [minHandle, maxHandle].
+	void fillUniformHandles(Range<NodeHandle> handles, NodeHandle minHandle, NodeHandle maxHandle)
+	{
+		CounterRandom(drawKey()).fillUniformHandles(handles, minHandle, maxHandle, threadPool());
+	}
+
+	// Empty scratch buffer for the edges.
+	__forceinline std::vector<Edge>& edges()
+	{
+		m_workspace.m_edges.clear();
+		return m_workspace.m_edges;
+	}
+
+	// Empty edge set with room for edgeCount edges.
+	__forceinline EdgeSet& edgeSet(size_t edgeCount)
+	{
+		m_workspace.m_edgeSet.reset(edgeCount);
+		return m_workspace.m_edgeSet;
+	}
+
+	// Builds topologies into buffers of graphs generated before.
+	__forceinline TopologyPool& topologies()
+	{
+		return m_workspace.m_topologies;
+	}
+
+	// Threads for building large graphs, such as with TopologyPool::build. May be null.
+	__forceinline ThreadPool* threadPool()
+	{
+		return m_workspace.m_threadPool;
+	}
 };
 
 class GeneratorParams final
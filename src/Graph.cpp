@@ -1,109 +1,860 @@
 #include "Graph.hpp"
+#include "ThreadPool.hpp"
+#include "Laplacian.hpp"
+#include "CounterRandom.hpp"
+
+#include <stdexcept>
+#include <numeric>
+#include <atomic>
+
+#if _WIN32
+#include <intrin.h>
+#endif
+
+GraphTopology::GraphTopology()
+	: m_kind(Explicit)
+	, m_size(0)
+	, m_width(0)
+	, m_edgeCount(0)
+	, m_hasDanglingNodes(false)
+{
+}
+
+GraphTopology::GraphTopology(size_t nodeCount, const std::set<Edge>& edges)
+	: GraphTopology()
+{
+	assignExplicit(nodeCount, edges);
+}
+
+GraphTopology::GraphTopology(size_t nodeCount, const std::vector<Edge>& edges, ThreadPool* threadPool)
+	: GraphTopology()
+{
+	assignExplicit(nodeCount, edges, threadPool);
+}
+
+template<typename Edges>
+void GraphTopology::assignExplicit(size_t nodeCount, const Edges& edges)
+{
+	m_kind = Explicit;
+	m_size = nodeCount;
+	m_width = 0;
+	m_edgeCount = edges.size();
+
+	m_degrees.assign(nodeCount, 0);
+	for (const auto& edge : edges)
+	{
+		++m_degrees[edge.a];
+		++m_degrees[edge.b];
+	}
+
+	m_connections.resize(nodeCount);
+	m_connectionBuffer.resize(m_edgeCount * 2);
+
+	NodeHandle* connectionIt = m_connectionBuffer.data();
+	for (size_t i = 0; i < nodeCount; ++i)
+	{
+		m_connections[i] = Range<NodeHandle>(connectionIt, m_degrees[i]);
+		connectionIt += m_degrees[i];
+	}
+
+	m_hasDanglingNodes = std::any_of(m_degrees.cbegin(), m_degrees.cend(), [] (uint32_t degree) {
+		return degree == 0;
+	});
+
+	// Count the degrees up again while filling in the connections.
+	std::fill(m_degrees.begin(), m_degrees.end(), 0);
+	for (const auto& edge : edges)
+	{
+		m_connections[edge.a][m_degrees[edge.a]++] = edge.b;
+		m_connections[edge.b][m_degrees[edge.b]++] = edge.a;
+	}
+}
+
+void GraphTopology::assignExplicit(size_t nodeCount, const std::vector<Edge>& edges, ThreadPool* threadPool)
+{
+	if (threadPool == nullptr || threadPool->size() == 1 || edges.size() < ParallelBuildThreshold)
+	{
+		assignExplicit(nodeCount, edges);
+		return;
+	}
+
+	m_kind = Explicit;
+	m_size = nodeCount;
+	m_width = 0;
+	m_edgeCount = edges.size();
+
+	// The nodes are split into one range per thread, and the edges into one chunk per
+	// thread. Every chunk sorts the ends of its edges into a bucket per node range, so
+	// that every range then only goes through the ends in it. Ends are kept in edge order
+	// within a chunk, and the buckets of a range in chunk order, so every node gets its
+	// connections in the order of the serial build. Besides the bucketed ends, the scratch
+	// memory is a counter per chunk and range, so it doesn't grow with the nodes.
+	const size_t threadCount = threadPool->size();
+	const size_t rangeSize = (nodeCount + threadCount - 1) / threadCount;
+	const auto rangeBegin = [nodeCount, rangeSize] (size_t range) {
+		return std::min(range * rangeSize, nodeCount);
+	};
+	const auto chunkBegin = [&edges, threadCount] (size_t chunk) {
+		return edges.size() * chunk / threadCount;
+	};
+
+	// Every chunk has a row of counters, one per range, padded to a cache line so that the
+	// chunks don't write to the same lines. The counts become the offset of every bucket
+	// in m_bucketedEnds, range by range and chunk by chunk within a range, and the scatter
+	// then moves them on to the end of the bucket.
+	const size_t rowSize = (threadCount + 7) & ~size_t(7);
+	m_bucketOffsets.assign(threadCount * rowSize, 0);
+	threadPool->run(threadCount, [&] (size_t chunk) {
+		size_t* counts = m_bucketOffsets.data() + chunk * rowSize;
+		for (size_t edgeIt = chunkBegin(chunk); edgeIt < chunkBegin(chunk + 1); ++edgeIt)
+		{
+			++counts[edges[edgeIt].a / rangeSize];
+			++counts[edges[edgeIt].b / rangeSize];
+		}
+	});
+
+	m_rangeOffsets.resize(threadCount + 1);
+	size_t offset = 0;
+	for (size_t range = 0; range < threadCount; ++range)
+	{
+		m_rangeOffsets[range] = offset;
+		for (size_t chunk = 0; chunk < threadCount; ++chunk)
+		{
+			const size_t count = m_bucketOffsets[chunk * rowSize + range];
+			m_bucketOffsets[chunk * rowSize + range] = offset;
+			offset += count;
+		}
+	}
+	m_rangeOffsets[threadCount] = offset;
+
+	// Each end is stored as the node and its neighbor.
+	m_bucketedEnds.resize(m_edgeCount * 4);
+	threadPool->run(threadCount, [&] (size_t chunk) {
+		size_t* cursors = m_bucketOffsets.data() + chunk * rowSize;
+		const auto addEnd = [this, cursors, rangeSize] (NodeHandle node, NodeHandle neighbor) {
+			NodeHandle* end = m_bucketedEnds.data() + 2 * cursors[node / rangeSize]++;
+			end[0] = node;
+			end[1] = neighbor;
+		};
+
+		for (size_t edgeIt = chunkBegin(chunk); edgeIt < chunkBegin(chunk + 1); ++edgeIt)
+		{
+			addEnd(edges[edgeIt].a, edges[edgeIt].b);
+			addEnd(edges[edgeIt].b, edges[edgeIt].a);
+		}
+	});
+
+	// The ends of a range come right after those of the ranges before it, in node order,
+	// which is also where its connections go.
+	m_degrees.resize(nodeCount);
+	m_connections.resize(nodeCount);
+	m_connectionBuffer.resize(m_edgeCount * 2);
+
+	std::atomic<bool> hasDanglingNodes(false);
+	threadPool->run(threadCount, [&] (size_t range) {
+		const size_t first = rangeBegin(range);
+		const size_t last = rangeBegin(range + 1);
+		const NodeHandle* endsBegin = m_bucketedEnds.data() + 2 * m_rangeOffsets[range];
+		const NodeHandle* endsEnd = m_bucketedEnds.data() + 2 * m_rangeOffsets[range + 1];
+
+		std::fill(m_degrees.begin() + first, m_degrees.begin() + last, 0);
+		for (const NodeHandle* end = endsBegin; end != endsEnd; end += 2)
+		{
+			++m_degrees[end[0]];
+		}
+
+		NodeHandle* connectionIt = m_connectionBuffer.data() + m_rangeOffsets[range];
+		bool rangeHasDanglingNodes = false;
+		for (size_t nodeIt = first; nodeIt < last; ++nodeIt)
+		{
+			m_connections[nodeIt] = Range<NodeHandle>(connectionIt, m_degrees[nodeIt]);
+			connectionIt += m_degrees[nodeIt];
+			rangeHasDanglingNodes |= m_degrees[nodeIt] == 0;
+			m_degrees[nodeIt] = 0;
+		}
+
+		if (rangeHasDanglingNodes)
+		{
+			hasDanglingNodes.store(true, std::memory_order_relaxed);
+		}
+
+		for (const NodeHandle* end = endsBegin; end != endsEnd; end += 2)
+		{
+			m_connections[end[0]][m_degrees[end[0]]++] = end[1];
+		}
+	});
+	m_hasDanglingNodes = hasDanglingNodes.load();
+}
+
+const Laplacian& GraphTopology::laplacian() const
+{
+	std::lock_guard<std::mutex> lock(m_laplacianMutex);
+	if (!m_laplacian)
+	{
+		m_laplacian = std::make_shared<const Laplacian>(*this);
+	}
+	return *m_laplacian;
+}
+
+void GraphTopology::assignImplicit(Kind kind, size_t nodeCount, size_t width, size_t edgeCount)
+{
+	if (nodeCount > std::numeric_limits<NodeHandle>::max())
+	{
+		throw std::invalid_argument("Too many nodes for a NodeHandle");
+	}
+
+	m_kind = kind;
+	m_size = nodeCount;
+	m_width = width;
+	m_edgeCount = edgeCount;
+	m_hasDanglingNodes = false;
+
+	m_connections.clear();
+	m_connectionBuffer.clear();
+}
+
+void GraphTopology::assignRing(size_t nodeCount)
+{
+	if (nodeCount < 3)
+	{
+		throw std::invalid_argument("A ring needs at least 3 nodes");
+	}
+	assignImplicit(Ring, nodeCount, 0, nodeCount);
+}
+
+void GraphTopology::assignStar(size_t nodeCount)
+{
+	if (nodeCount < 2)
+	{
+		throw std::invalid_argument("A star needs at least 2 nodes");
+	}
+	assignImplicit(Star, nodeCount, 0, nodeCount - 1);
+}
+
+void GraphTopology::assignTorus(size_t width, size_t height)
+{
+	if (width < 3 || height < 3)
+	{
+		throw std::invalid_argument("A torus needs at least 3 x 3 nodes");
+	}
+	assignImplicit(Torus, width * height, width, width * height * 2);
+}
+
+std::shared_ptr<const GraphTopology> GraphTopology::ring(size_t nodeCount)
+{
+	std::shared_ptr<GraphTopology> topology(new GraphTopology());
+	topology->assignRing(nodeCount);
+	return topology;
+}
+
+std::shared_ptr<const GraphTopology> GraphTopology::star(size_t nodeCount)
+{
+	std::shared_ptr<GraphTopology> topology(new GraphTopology());
+	topology->assignStar(nodeCount);
+	return topology;
+}
+
+std::shared_ptr<const GraphTopology> GraphTopology::torus(size_t width, size_t height)
+{
+	std::shared_ptr<GraphTopology> topology(new GraphTopology());
+	topology->assignTorus(width, height);
+	return topology;
+}
+
+GraphTopology& TopologyPool::acquire(std::shared_ptr<const GraphTopology>& outTopology)
+{
+	// A topology only the pool refers to is no longer part of any graph.
+	auto freeIt = std::find_if(m_topologies.begin(), m_topologies.end(), [] (const std::shared_ptr<GraphTopology>& topology) {
+		return topology.use_count() == 1;
+	});
+
+	if (freeIt == m_topologies.end())
+	{
+		m_topologies.emplace_back(new GraphTopology());
+		freeIt = m_topologies.end() - 1;
+	}
+
+	// The Laplacian of the old adjacency would be stale.
+	(*freeIt)->m_laplacian.reset();
+
+	outTopology = *freeIt;
+	return **freeIt;
+}
+
+std::shared_ptr<const GraphTopology> TopologyPool::build(size_t nodeCount, const std::vector<Edge>& edges, ThreadPool* threadPool)
+{
+	std::shared_ptr<const GraphTopology> topology;
+	acquire(topology).assignExplicit(nodeCount, edges, threadPool);
+	return topology;
+}
+
+std::shared_ptr<const GraphTopology> TopologyPool::ring(size_t nodeCount)
+{
+	std::shared_ptr<const GraphTopology> topology;
+	acquire(topology).assignRing(nodeCount);
+	return topology;
+}
+
+std::shared_ptr<const GraphTopology> TopologyPool::star(size_t nodeCount)
+{
+	std::shared_ptr<const GraphTopology> topology;
+	acquire(topology).assignStar(nodeCount);
+	return topology;
+}
+
+std::shared_ptr<const GraphTopology> TopologyPool::torus(size_t width, size_t height)
+{
+	std::shared_ptr<const GraphTopology> topology;
+	acquire(topology).assignTorus(width, height);
+	return topology;
+}
+
+StateHashKeys::StateHashKeys(const GraphTopology& topology)
+{
+	m_keys.resize(topology.size());
+	for (size_t i = 0; i < m_keys.size(); ++i)
+	{
+		m_keys[i] = splitMix64(i);
+	}
+
+	m_giveDeltas.resize(topology.size());
+	for (size_t i = 0; i < m_giveDeltas.size(); ++i)
+	{
+		// The node pays one dollar to each neighbor.
+		uint64_t delta = 0;
+		const size_t degree = topology.forEachConnection((NodeHandle)i, [this, &delta] (NodeHandle connection) {
+			delta += m_keys[connection];
+		});
+		m_giveDeltas[i] = delta - m_keys[i] * (uint64_t)degree;
+	}
+}
+
+uint64_t StateHashKeys::hash(const HugePageVector<NodeValue>& values) const
+{
+	assert(values.size() == m_keys.size());
+
+	uint64_t hash = 0;
+	for (size_t i = 0; i < values.size(); ++i)
+	{
+		hash += m_keys[i] * (uint64_t)(int64_t)values[i];
+	}
+	return hash;
+}
+
+void ValueHistogram::add(int64_t value)
+{
+	if (m_counts.empty())
+	{
+		m_first = value;
+	}
+
+	// Grows by at least its size, so that a drifting range costs amortized O(1).
+	if (value < m_first)
+	{
+		const size_t growth = std::max((size_t)(m_first - value), m_counts.size());
+		m_counts.insert(m_counts.begin(), growth, 0);
+		m_first -= (int64_t)growth;
+	}
+	else if (value - m_first >= (int64_t)m_counts.size())
+	{
+		const size_t growth = std::max((size_t)(value - m_first) + 1 - m_counts.size(), m_counts.size());
+		m_counts.resize(m_counts.size() + growth, 0);
+	}
+	++m_counts[(size_t)(value - m_first)];
+}
+
+void Graph::addToNode(NodeHandle node, NodeValue delta)
+{
+	NodeValue& value = m_values[node];
+	const bool wasDebtor = value < 0;
+	value += delta;
+	if (wasDebtor != (value < 0))
+	{
+		if (wasDebtor)
+		{
+			removeDebtor(node);
+		}
+		else
+		{
+			addDebtor(node);
+		}
+	}
+}
+
+void Graph::addToSatellite(NodeHandle node, uint32_t hubIndex, NodeValue delta)
+{
+	LazyHub& hub = m_hubs[hubIndex];
+	if (!hub.isDirty)
+	{
+		addToNode(node, delta);
+		return;
+	}
+
+	NodeValue& value = m_values[node];
+	const bool wasDebtor = value + hub.pending < 0;
+	hub.satelliteValues.remove(value);
+	value += delta;
+	hub.satelliteValues.add(value);
+
+	const bool isDebtor = value + hub.pending < 0;
+	if (wasDebtor != isDebtor)
+	{
+		m_hiddenDebtorCount += isDebtor ? 1 : -1;
+	}
+}
+
+template<bool isTake>
+void Graph::fireLazy(NodeHandle node)
+{
+	const NodeValue neighborDelta = isTake ? -1 : 1;
+	const uint32_t hubCount = (uint32_t)m_hubs.size();
+	const uint32_t role = m_hubRoles[node];
+
+	if (role >= hubCount && role < 2 * hubCount)
+	{
+		const uint32_t hubIndex = role - hubCount;
+		LazyHub& hub = m_hubs[hubIndex];
+		if (!hub.isDirty)
+		{
+			// The first move after the hub was settled counts the satellite values, which
+			// costs as much as the settling will.
+			hub.isDirty = true;
+			m_dirtyHubs.push_back(hubIndex);
+			hub.satelliteValues.clear();
+			m_topology->forEachConnection(node, [this, hubIndex, &hub] (NodeHandle connection) {
+				if (m_hubRoles[connection] == hubIndex)
+				{
+					hub.satelliteValues.add(m_values[connection]);
+				}
+			});
+		}
+
+		// Only the satellites one dollar short of zero, or at zero, cross it.
+		const int64_t pending = hub.pending;
+		if (isTake)
+		{
+			m_hiddenDebtorCount += hub.satelliteValues.count(-pending);
+		}
+		else
+		{
+			m_hiddenDebtorCount -= hub.satelliteValues.count(-1 - pending);
+		}
+		hub.pending += neighborDelta;
+
+		for (const NodeHandle neighbor : hub.eagerNeighbors)
+		{
+			addToNode(neighbor, neighborDelta);
+		}
+		addToNode(node, -neighborDelta * static_cast<NodeValue>(m_topology->degree(node)));
+	}
+	else
+	{
+		const size_t degree = m_topology->forEachConnection(node, [this, hubCount, neighborDelta] (NodeHandle connection) {
+			const uint32_t connectionRole = m_hubRoles[connection];
+			if (connectionRole < hubCount)
+			{
+				addToSatellite(connection, connectionRole, neighborDelta);
+			}
+			else
+			{
+				addToNode(connection, neighborDelta);
+			}
+		});
+
+		if (role < hubCount)
+		{
+			addToSatellite(node, role, -neighborDelta * static_cast<NodeValue>(degree));
+		}
+		else
+		{
+			addToNode(node, -neighborDelta * static_cast<NodeValue>(degree));
+		}
+	}
+
+	if (m_stateHashKeys)
+	{
+		if (isTake)
+		{
+			m_stateHash -= m_stateHashKeys->giveDelta(node);
+		}
+		else
+		{
+			m_stateHash += m_stateHashKeys->giveDelta(node);
+		}
+	}
+}
+
+void Graph::settleHubs() const
+{
+	for (const uint32_t hubIndex : m_dirtyHubs)
+	{
+		LazyHub& hub = m_hubs[hubIndex];
+		const NodeValue pending = hub.pending;
+		m_topology->forEachConnection(hub.node, [this, hubIndex, pending] (NodeHandle connection) {
+			if (m_hubRoles[connection] != hubIndex)
+			{
+				return;
+			}
+
+			NodeValue& value = m_values[connection];
+			value += pending;
+			const bool isDebtor = value < 0;
+			if (isDebtor != isListedDebtor(connection))
+			{
+				if (isDebtor)
+				{
+					addDebtor(connection);
+					--m_hiddenDebtorCount;
+				}
+				else
+				{
+					removeDebtor(connection);
+					++m_hiddenDebtorCount;
+				}
+			}
+		});
+
+		hub.pending = 0;
+		hub.isDirty = false;
+	}
+	m_dirtyHubs.clear();
+	assert(m_hiddenDebtorCount == 0);
+}
+
+void Graph::findHubs()
+{
+	m_dirtyHubs.clear();
+	m_hubRoles.clear();
+	m_hiddenDebtorCount = 0;
+
+	const GraphTopology& topology = *m_topology;
+	const bool mayHaveHubs = topology.kind() != GraphTopology::Ring && topology.kind() != GraphTopology::Torus;
+
+	// Hubs are resized rather than cleared, so that graphs re-initialized on the same
+	// topology keep the buffers of their entries.
+	uint32_t hubCount = 0;
+	for (NodeHandle node = 0; mayHaveHubs && node < m_values.size(); ++node)
+	{
+		hubCount += topology.degree(node) >= LazyHubDegree;
+	}
+
+	m_hubs.resize(hubCount);
+	if (hubCount == 0)
+	{
+		return;
+	}
+
+	uint32_t nextHub = 0;
+	for (NodeHandle node = 0; node < m_values.size(); ++node)
+	{
+		if (topology.degree(node) >= LazyHubDegree)
+		{
+			LazyHub& hub = m_hubs[nextHub++];
+			hub.node = node;
+			hub.pending = 0;
+			hub.isDirty = false;
+			hub.satelliteValues.clear();
+			hub.eagerNeighbors.clear();
+		}
+	}
+
+	m_hubRoles.assign(m_values.size(), NoHub);
+	for (uint32_t hubIndex = 0; hubIndex < hubCount; ++hubIndex)
+	{
+		m_hubRoles[m_hubs[hubIndex].node] = hubCount + hubIndex;
+	}
+
+	for (uint32_t hubIndex = 0; hubIndex < hubCount; ++hubIndex)
+	{
+		topology.forEachConnection(m_hubs[hubIndex].node, [this, hubIndex] (NodeHandle connection) {
+			uint32_t& role = m_hubRoles[connection];
+			if (role == NoHub)
+			{
+				role = hubIndex;
+			}
+			else if (role < hubIndex)
+			{
+				role = SharedHubs;
+			}
+		});
+	}
+
+	for (uint32_t hubIndex = 0; hubIndex < hubCount; ++hubIndex)
+	{
+		LazyHub& hub = m_hubs[hubIndex];
+		topology.forEachConnection(hub.node, [this, hubIndex, &hub] (NodeHandle connection) {
+			if (m_hubRoles[connection] != hubIndex)
+			{
+				hub.eagerNeighbors.push_back(connection);
+			}
+		});
+	}
+}
 
 void Graph::give(NodeHandle node)
 {
 	assert(node != NullNode);
-	for (NodeHandle connection : m_connections[node])
+	if (!m_hubs.empty())
+	{
+		fireLazy<false>(node);
+		return;
+	}
+
+	const size_t degree = m_topology->forEachConnection(node, [this] (NodeHandle connection) {
+		if (++m_values[connection] == 0)
+		{
+			removeDebtor(connection);
+		}
+	});
+
+	NodeValue& value = m_values[node];
+	const bool wasDebtor = value < 0;
+	value -= static_cast<NodeValue>(degree);
+	if (!wasDebtor && value < 0)
+	{
+		addDebtor(node);
+	}
+
+	if (m_stateHashKeys)
 	{
-		++m_values[connection];
+		m_stateHash += m_stateHashKeys->giveDelta(node);
 	}
-	m_values[node] -= static_cast<NodeValue>(m_connections[node].size());
 }
 
 void Graph::take(NodeHandle node)
 {
 	assert(node != NullNode);
-	for (NodeHandle connection : m_connections[node])
+	if (!m_hubs.empty())
 	{
-		--m_values[connection];
+		fireLazy<true>(node);
+		return;
 	}
-	m_values[node] += static_cast<NodeValue>(m_connections[node].size());
-}
 
-Graph::Graph(const Graph& rhs)
-	: m_connectionBuffer(rhs.m_connectionBuffer)
-	, m_values(rhs.m_values)
-{
-	// The connection ranges have to be moved manually to the new buffer location.
-	const ptrdiff_t diff = m_connectionBuffer.data() - rhs.m_connectionBuffer.data();
-	m_connections.reserve(rhs.m_connections.size());
-	for (const auto& conn : rhs.m_connections)
+	const size_t degree = m_topology->forEachConnection(node, [this] (NodeHandle connection) {
+		if (m_values[connection]-- == 0)
+		{
+			addDebtor(connection);
+		}
+	});
+
+	NodeValue& value = m_values[node];
+	const bool wasDebtor = value < 0;
+	value += static_cast<NodeValue>(degree);
+	if (wasDebtor && value >= 0)
+	{
+		removeDebtor(node);
+	}
+
+	if (m_stateHashKeys)
 	{
-		m_connections.push_back(Range<NodeHandle>(conn.begin() + diff, conn.size()));
+		m_stateHash -= m_stateHashKeys->giveDelta(node);
 	}
 }
 
-void Graph::init(
-	const std::vector<NodeValue>& values,
-	const std::set<Edge>& edges)
+// Adds to a value that other threads update too, and returns the old value.
+static inline NodeValue atomicAdd(NodeValue& value, NodeValue delta)
 {
-	const size_t nodeCount = values.size();
-	const size_t edgeCount = edges.size();
+#if _WIN32
+	return (NodeValue)_InterlockedExchangeAdd(reinterpret_cast<volatile long*>(&value), (long)delta);
+#else
+	return __atomic_fetch_add(&value, delta, __ATOMIC_RELAXED);
+#endif
+}
 
-	m_values = values;
+// Nodes per task of a batched move.
+static constexpr size_t BatchTaskSize = 512;
 
-	std::vector<uint32_t> connectionCount(nodeCount);
-	std::fill(connectionCount.begin(), connectionCount.end(), 0);
+template<bool isTake>
+void Graph::fireAll(Range<const NodeHandle> nodes, ThreadPool* threadPool)
+{
+	const NodeValue neighborDelta = isTake ? -1 : 1;
 
-	for (const auto& edge : edges)
+	// Every node crosses zero at most once, since the nodes of the batch only move one way
+	// and their neighbors only the other. New debtors are collected at the front of the
+	// scratch buffer, and former ones at the back.
+	size_t maxChangeCount = nodes.size();
+	for (const NodeHandle node : nodes)
 	{
-		++connectionCount[edge.a];
-		++connectionCount[edge.b];
+		maxChangeCount += m_topology->degree(node);
 	}
+	m_batchChanges.resize(std::min(maxChangeCount, m_values.size()));
+	std::atomic<size_t> newDebtorCount(0);
+	std::atomic<size_t> formerDebtorCount(0);
+	const auto recordChange = [this, &newDebtorCount, &formerDebtorCount] (NodeHandle node, bool isDebtor) {
+		if (isDebtor)
+		{
+			m_batchChanges[newDebtorCount.fetch_add(1, std::memory_order_relaxed)] = node;
+		}
+		else
+		{
+			m_batchChanges[m_batchChanges.size() - 1 - formerDebtorCount.fetch_add(1, std::memory_order_relaxed)] = node;
+		}
+	};
 
-	m_connections.resize(nodeCount);
-	m_connectionBuffer.resize(edgeCount * 2);
+	const auto fireTask = [&] (size_t taskIndex) {
+		const size_t end = std::min(nodes.size(), (taskIndex + 1) * BatchTaskSize);
+		for (size_t nodeIt = taskIndex * BatchTaskSize; nodeIt < end; ++nodeIt)
+		{
+			const NodeHandle node = nodes[nodeIt];
+			const size_t degree = m_topology->forEachConnection(node, [&] (NodeHandle connection) {
+				// Neighbors may be shared, so they are updated atomically. Exactly one of
+				// the updates sees the value cross zero.
+				const NodeValue oldValue = atomicAdd(m_values[connection], neighborDelta);
+				if ((oldValue < 0) != (oldValue + neighborDelta < 0))
+				{
+					recordChange(connection, oldValue >= 0);
+				}
+			});
 
-	NodeHandle* connectionIt = m_connectionBuffer.data();
-	for (size_t i = 0; i < nodeCount; ++i)
+			// No other move of the batch touches the node itself.
+			NodeValue& value = m_values[node];
+			const bool wasDebtor = value < 0;
+			value -= neighborDelta * static_cast<NodeValue>(degree);
+			if (wasDebtor != (value < 0))
+			{
+				recordChange(node, !wasDebtor);
+			}
+		}
+	};
+
+	const size_t taskCount = (nodes.size() + BatchTaskSize - 1) / BatchTaskSize;
+	if (threadPool)
+	{
+		threadPool->run(taskCount, fireTask);
+	}
+	else
 	{
-		const size_t count = connectionCount[i];
-		m_connections[i] = Range<NodeHandle>(connectionIt, count);
-		connectionIt += count;
+		for (size_t taskIndex = 0; taskIndex < taskCount; ++taskIndex)
+		{
+			fireTask(taskIndex);
+		}
 	}
 
-	std::vector<size_t> connectionIterators;
-	connectionIterators.resize(nodeCount);
-	std::fill(connectionIterators.begin(), connectionIterators.end(), 0);
-	for (const auto& edge : edges)
+	// Threads race for the change slots, so sort them before touching the debtor set.
+	const auto newDebtorsEnd = m_batchChanges.begin() + newDebtorCount.load();
+	const auto formerDebtorsBegin = m_batchChanges.end() - formerDebtorCount.load();
+	std::sort(m_batchChanges.begin(), newDebtorsEnd);
+	std::sort(formerDebtorsBegin, m_batchChanges.end());
+
+	for (auto it = formerDebtorsBegin; it != m_batchChanges.end(); ++it)
+	{
+		removeDebtor(*it);
+	}
+	for (auto it = m_batchChanges.begin(); it != newDebtorsEnd; ++it)
 	{
-		size_t& it_a = connectionIterators[edge.a];
-		size_t& it_b = connectionIterators[edge.b];
+		addDebtor(*it);
+	}
+	m_batchChanges.clear();
 
-		m_connections[edge.a][it_a++] = edge.b;
-		m_connections[edge.b][it_b++] = edge.a;
+	if (m_stateHashKeys)
+	{
+		for (const NodeHandle node : nodes)
+		{
+			if (isTake)
+			{
+				m_stateHash -= m_stateHashKeys->giveDelta(node);
+			}
+			else
+			{
+				m_stateHash += m_stateHashKeys->giveDelta(node);
+			}
+		}
 	}
 }
 
-bool Graph::isSolvable() const
+// With lazy hubs the moves are applied one by one. A hub move is O(1) then, and the
+// satellites would have to update the counts of their hub from several threads.
+void Graph::giveAll(Range<const NodeHandle> nodes, ThreadPool* threadPool)
+{
+	if (!m_hubs.empty())
+	{
+		for (const NodeHandle node : nodes)
+		{
+			fireLazy<false>(node);
+		}
+		return;
+	}
+
+	fireAll<false>(nodes, threadPool);
+}
+
+void Graph::takeAll(Range<const NodeHandle> nodes, ThreadPool* threadPool)
+{
+	if (!m_hubs.empty())
+	{
+		for (const NodeHandle node : nodes)
+		{
+			fireLazy<true>(node);
+		}
+		return;
+	}
+
+	fireAll<true>(nodes, threadPool);
+}
+
+void Graph::init(
+	const std::vector<NodeValue>& values,
+	const std::set<Edge>& edges)
+{
+	init(values, std::make_shared<const GraphTopology>(values.size(), edges));
+}
+
+void Graph::init(
+	const std::vector<NodeValue>& values,
+	std::shared_ptr<const GraphTopology> topology)
 {
-	std::set<Edge> edges;
+	assert(topology && topology->size() == values.size());
+	m_topology = std::move(topology);
+	m_values.assign(values.cbegin(), values.cend());
 
-	const size_t nodeCount = size();
-	for (NodeHandle nodeIt = 0; nodeIt < nodeCount; ++nodeIt)
+	m_valueSum = 0;
+	m_debtors.clear();
+	m_debtorPositions.resize(m_values.size());
+	for (NodeHandle nodeIt = 0; nodeIt < m_values.size(); ++nodeIt)
 	{
-		for (NodeHandle connection : getNodeConnections(nodeIt))
+		m_valueSum += m_values[nodeIt];
+		if (m_values[nodeIt] < 0)
 		{
-			edges.emplace(nodeIt, connection);
+			addDebtor(nodeIt);
 		}
 	}
 
-	const ptrdiff_t edgeCount = static_cast<ptrdiff_t>(edges.size());
-	const ptrdiff_t vertexCount = static_cast<ptrdiff_t>(nodeCount);
-	const ptrdiff_t genus = edgeCount - vertexCount + 1;
+	findHubs();
 
-	NodeValue sum = 0;
-	for (NodeValue value : m_values)
+	// The keys belong to the old topology.
+	if (m_stateHashKeys)
 	{
-		sum += value;
+		m_stateHashKeys.reset();
+		enableStateHash();
 	}
+}
 
-	return sum >= genus;
+void Graph::reset()
+{
+	m_topology.reset();
+	m_values.clear();
+	m_valueSum = 0;
+	m_debtors.clear();
+	m_debtorPositions.clear();
+	// The hubs are left for findHubs to resize, like the other buffers. Nothing reads
+	// them without a topology.
+	m_dirtyHubs.clear();
+	m_hubRoles.clear();
+	m_hiddenDebtorCount = 0;
+	m_stateHashKeys.reset();
+	m_stateHash = 0;
 }
 
-bool Graph::isSolved() const
+void Graph::enableStateHash()
 {
-	return std::all_of(m_values.cbegin(), m_values.cend(), [] (auto value) {
-		return value >= 0;
-	});
+	if (!m_stateHashKeys)
+	{
+		m_stateHashKeys = std::make_shared<const StateHashKeys>(*m_topology);
+	}
+	m_stateHash = m_stateHashKeys->hash(values());
+}
+
+bool Graph::isSolvable() const
+{
+	return m_valueSum >= m_topology->genus();
 }
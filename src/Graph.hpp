@@ -5,6 +5,15 @@
 #include <algorithm>
 #include <cassert>
 #include <cinttypes>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <mutex>
+
+#include "HugePageAllocator.hpp"
+
+class ThreadPool;
+class Laplacian;
 
 typedef uint32_t NodeHandle;
 typedef int32_t NodeValue;
@@ -107,57 +116,603 @@ namespace std
 	};
 }
 
+// The neighbors of one node. For explicit topologies this is a view of the stored
+// adjacency. Implicit topologies compute the neighbors from the node handle instead, as a
+// few handles kept inline or, for the center of a star, as a sequence of handles.
+class NodeConnections final
+{
+private:
+	const NodeHandle* m_stored;
+	NodeHandle m_computed[4];
+	NodeHandle m_first;
+	uint32_t m_count;
+	bool m_isSequence;
+
+public:
+	class Iterator final
+	{
+	private:
+		const NodeConnections* m_connections;
+		uint32_t m_index;
+
+	public:
+		Iterator(const NodeConnections* connections, uint32_t index)
+			: m_connections(connections)
+			, m_index(index)
+		{
+		}
+
+		__forceinline NodeHandle operator*() const
+		{
+			return (*m_connections)[m_index];
+		}
+
+		__forceinline Iterator& operator++()
+		{
+			++m_index;
+			return *this;
+		}
+
+		__forceinline bool operator!=(const Iterator& other) const
+		{
+			return m_index != other.m_index;
+		}
+	};
+
+	NodeConnections(const Range<NodeHandle>& stored)
+		: m_stored(stored.data())
+		, m_first(0)
+		, m_count((uint32_t)stored.size())
+		, m_isSequence(false)
+	{
+	}
+
+	NodeConnections(NodeHandle first, uint32_t count)
+		: m_stored(nullptr)
+		, m_first(first)
+		, m_count(count)
+		, m_isSequence(true)
+	{
+	}
+
+	NodeConnections()
+		: m_stored(nullptr)
+		, m_first(0)
+		, m_count(0)
+		, m_isSequence(false)
+	{
+	}
+
+	// Only for the implicit topologies, which have at most four computed neighbors.
+	__forceinline void push(NodeHandle handle)
+	{
+		assert(m_count < 4);
+		m_computed[m_count++] = handle;
+	}
+
+	__forceinline NodeHandle operator[](size_t i) const
+	{
+		assert(i < m_count);
+		if (m_stored)
+		{
+			return m_stored[i];
+		}
+		else if (m_isSequence)
+		{
+			return m_first + (NodeHandle)i;
+		}
+		return m_computed[i];
+	}
+
+	__forceinline Iterator begin() const
+	{
+		return Iterator(this, 0);
+	}
+
+	__forceinline Iterator end() const
+	{
+		return Iterator(this, m_count);
+	}
+
+	__forceinline size_t size() const
+	{
+		return m_count;
+	}
+
+	__forceinline bool empty() const
+	{
+		return m_count == 0;
+	}
+};
+
+// The adjacency of a graph. A topology is immutable once built and is shared between all
+// copies of a Graph, so copying a graph only has to copy its node values.
+//
+// Explicit topologies store one connection range per node into a shared buffer. Rings,
+// stars and tori are implicit: their neighbors follow from the node handle, so they cost
+// no memory beyond a few sizes and moves on them reduce to index arithmetic.
+class GraphTopology final
+{
+public:
+	enum Kind
+	{
+		Explicit,
+		// Node i is connected to i - 1 and i + 1, wrapping around.
+		Ring,
+		// Node 0 is the center, connected to every other node.
+		Star,
+		// A width x height grid that wraps around at its edges. Node i is at column
+		// i % width of row i / width.
+		Torus,
+	};
+
+private:
+	friend class TopologyPool;
+
+	Kind m_kind;
+	size_t m_size;
+	size_t m_width;
+
+	// Explicit topologies only.
+	HugePageVector<Range<NodeHandle>> m_connections;
+	HugePageVector<NodeHandle> m_connectionBuffer;
+
+	// Node degrees while building an explicit topology. A parallel build also buckets the
+	// edge ends by edge chunk and node range, and keeps the offsets of the buckets and of
+	// every range. Kept so that rebuilding a pooled topology doesn't allocate.
+	std::vector<uint32_t> m_degrees;
+	std::vector<size_t> m_bucketOffsets;
+	std::vector<size_t> m_rangeOffsets;
+	std::vector<NodeHandle> m_bucketedEnds;
+
+	size_t m_edgeCount;
+	bool m_hasDanglingNodes;
+
+	// Null until laplacian is first called, and again once the pool rebuilds the topology.
+	mutable std::mutex m_laplacianMutex;
+	mutable std::shared_ptr<const Laplacian> m_laplacian;
+
+	GraphTopology();
+
+	// Rebuild the topology in place, keeping the buffers of an explicit one.
+	template<typename Edges>
+	void assignExplicit(size_t nodeCount, const Edges& edges);
+	void assignExplicit(size_t nodeCount, const std::vector<Edge>& edges, ThreadPool* threadPool);
+	void assignImplicit(Kind kind, size_t nodeCount, size_t width, size_t edgeCount);
+	void assignRing(size_t nodeCount);
+	void assignStar(size_t nodeCount);
+	void assignTorus(size_t width, size_t height);
+
+public:
+	// Edge lists at least this long are built in parallel when a thread pool is given.
+	static constexpr size_t ParallelBuildThreshold = 1 << 16;
+
+	GraphTopology(size_t nodeCount, const std::set<Edge>& edges);
+
+	// The adjacency of every node lists its neighbors in the order of the edges, so sort the
+	// edges to get the same topology as from a std::set. Edges must be unique. With a thread
+	// pool, large edge lists are built by all threads at once, each counting and scattering
+	// the ends in a range of nodes of its own. The result is the same.
+	GraphTopology(size_t nodeCount, const std::vector<Edge>& edges, ThreadPool* threadPool = nullptr);
+
+	GraphTopology(const GraphTopology&) = delete;
+
+	// Implicit topologies. Throw std::invalid_argument for sizes that would need
+	// duplicate edges or self loops: rings need 3 nodes, stars 2, tori 3 x 3.
+	static std::shared_ptr<const GraphTopology> ring(size_t nodeCount);
+	static std::shared_ptr<const GraphTopology> star(size_t nodeCount);
+	static std::shared_ptr<const GraphTopology> torus(size_t width, size_t height);
+
+	__forceinline Kind kind() const
+	{
+		return m_kind;
+	}
+
+	__forceinline size_t size() const
+	{
+		return m_size;
+	}
+
+	__forceinline size_t edgeCount() const
+	{
+		return m_edgeCount;
+	}
+
+	__forceinline ptrdiff_t genus() const
+	{
+		return static_cast<ptrdiff_t>(m_edgeCount) - static_cast<ptrdiff_t>(size()) + 1;
+	}
+
+	__forceinline bool hasDanglingNodes() const
+	{
+		return m_hasDanglingNodes;
+	}
+
+	// The Laplacian, built on the first call. Thread-safe, so the solvers of all copies of a
+	// graph share one. Costs O(V + E) memory.
+	const Laplacian& laplacian() const;
+
+	__forceinline size_t degree(NodeHandle handle) const
+	{
+		assert(handle != NullNode);
+		switch (m_kind)
+		{
+		case Ring:
+			return 2;
+		case Star:
+			return handle == 0 ? m_size - 1 : 1;
+		case Torus:
+			return 4;
+		default:
+			return m_connections[handle].size();
+		}
+	}
+
+	// Calls fn for every neighbor of the node and returns the degree of the node. This is
+	// the fastest way to visit the neighbors, as the topology kind is only checked once.
+	template<typename Fn>
+	__forceinline size_t forEachConnection(NodeHandle handle, Fn&& fn) const
+	{
+		assert(handle != NullNode);
+		switch (m_kind)
+		{
+		case Ring:
+		{
+			const NodeHandle last = (NodeHandle)m_size - 1;
+			fn(handle == 0 ? last : handle - 1);
+			fn(handle == last ? 0 : handle + 1);
+			return 2;
+		}
+		case Star:
+		{
+			if (handle != 0)
+			{
+				fn(0);
+				return 1;
+			}
+			for (NodeHandle connection = 1; connection < m_size; ++connection)
+			{
+				fn(connection);
+			}
+			return m_size - 1;
+		}
+		case Torus:
+		{
+			const NodeHandle width = (NodeHandle)m_width;
+			const NodeHandle size = (NodeHandle)m_size;
+			const NodeHandle column = handle % width;
+			const NodeHandle rowStart = handle - column;
+			fn(rowStart + (column == 0 ? width - 1 : column - 1));
+			fn(rowStart + (column == width - 1 ? 0 : column + 1));
+			fn(handle < width ? handle + size - width : handle - width);
+			fn(handle >= size - width ? handle + width - size : handle + width);
+			return 4;
+		}
+		default:
+		{
+			const Range<NodeHandle>& connections = m_connections[handle];
+			for (NodeHandle connection : connections)
+			{
+				fn(connection);
+			}
+			return connections.size();
+		}
+		}
+	}
+
+	NodeConnections getNodeConnections(NodeHandle handle) const
+	{
+		assert(handle != NullNode);
+		if (m_kind == Explicit)
+		{
+			return NodeConnections(m_connections[handle]);
+		}
+		else if (m_kind == Star && handle == 0)
+		{
+			return NodeConnections(1, (uint32_t)m_size - 1);
+		}
+
+		NodeConnections connections;
+		forEachConnection(handle, [&connections] (NodeHandle connection) {
+			connections.push(connection);
+		});
+		return connections;
+	}
+};
+
+// Hands out topologies that reuse the buffers of pooled topologies no graph refers to
+// anymore. The harness keeps one per worker, so that generating a graph of a size seen
+// before doesn't allocate. Not thread safe.
+class TopologyPool final
+{
+private:
+	std::vector<std::shared_ptr<GraphTopology>> m_topologies;
+
+	GraphTopology& acquire(std::shared_ptr<const GraphTopology>& outTopology);
+
+public:
+	TopologyPool() = default;
+	TopologyPool(const TopologyPool&) = delete;
+
+	// Same as the GraphTopology constructor and factories.
+	std::shared_ptr<const GraphTopology> build(size_t nodeCount, const std::vector<Edge>& edges, ThreadPool* threadPool = nullptr);
+	std::shared_ptr<const GraphTopology> ring(size_t nodeCount);
+	std::shared_ptr<const GraphTopology> star(size_t nodeCount);
+	std::shared_ptr<const GraphTopology> torus(size_t width, size_t height);
+};
+
+// Keys of the additive state hash, sum(key[node] * value[node]) mod 2^64. A give changes
+// the values of a node and its neighbors by fixed amounts, so it changes the hash by a
+// fixed per-node delta whatever the values are. Keeping the hash up to date then costs
+// one addition per move, and values are not limited to a range as with Zobrist keys.
+class StateHashKeys final
+{
+private:
+	std::vector<uint64_t> m_keys;
+	std::vector<uint64_t> m_giveDeltas;
+
+public:
+	StateHashKeys(const GraphTopology& topology);
+	StateHashKeys(const StateHashKeys&) = delete;
+
+	uint64_t hash(const HugePageVector<NodeValue>& values) const;
+
+	__forceinline uint64_t giveDelta(NodeHandle handle) const
+	{
+		assert(handle != NullNode);
+		return m_giveDeltas[handle];
+	}
+};
+
+// How many nodes have each value, for the satellites of a lazy hub. Covers the range of
+// values it has seen, which moves keep narrow.
+class ValueHistogram final
+{
+private:
+	std::vector<uint32_t> m_counts;
+	int64_t m_first = 0;
+
+public:
+	void clear()
+	{
+		m_counts.clear();
+		m_first = 0;
+	}
+
+	void add(int64_t value);
+
+	__forceinline void remove(int64_t value)
+	{
+		assert(count(value) > 0);
+		--m_counts[(size_t)(value - m_first)];
+	}
+
+	__forceinline uint32_t count(int64_t value) const
+	{
+		const int64_t index = value - m_first;
+		return index >= 0 && index < (int64_t)m_counts.size() ? m_counts[(size_t)index] : 0;
+	}
+};
+
+// A node with so many neighbors that its moves are applied lazily. See Graph.
+struct LazyHub
+{
+	NodeHandle node = NullNode;
+
+	// Net gives of the hub that its satellites haven't received yet.
+	NodeValue pending = 0;
+
+	// Whether the hub moved since its satellites were last settled. The debtor list is out
+	// of date for the satellites of dirty hubs.
+	bool isDirty = false;
+
+	// Satellites by their stored value, without the pending gives. Only kept while dirty.
+	ValueHistogram satelliteValues;
+
+	// The neighbors that aren't satellites, other hubs and nodes next to several hubs,
+	// which are updated right away.
+	std::vector<NodeHandle> eagerNeighbors;
+};
+
 class Graph final
 {
+public:
+	// Nodes with at least this many neighbors are lazy hubs.
+	static constexpr size_t LazyHubDegree = 256;
+
 private:
-	std::vector<NodeValue> m_values;
-	std::vector<Range<NodeHandle>> m_connections;
-	std::vector<NodeHandle> m_connectionBuffer;
+	// The hub role of nodes next to no hub, and of nodes next to several hubs.
+	static constexpr uint32_t NoHub = std::numeric_limits<uint32_t>::max();
+	static constexpr uint32_t SharedHubs = NoHub - 1;
+
+	std::shared_ptr<const GraphTopology> m_topology;
+
+	// Mutable, as reading the values or debtors as a whole settles the lazy hubs first.
+	mutable HugePageVector<NodeValue> m_values;
+
+	// Moves only shift dollars between nodes, so the sum is fixed from init onwards.
+	int64_t m_valueSum = 0;
+
+	// Sparse set of the nodes in debt: m_debtors lists them in no particular order, and
+	// m_debtorPositions holds each node's index in that list. Moves update it whenever a
+	// value crosses zero.
+	mutable HugePageVector<NodeHandle> m_debtors;
+	mutable HugePageVector<uint32_t> m_debtorPositions;
+
+	// Nodes with LazyHubDegree neighbors or more are lazy hubs. A move of a hub only adds to
+	// its pending gives, instead of visiting all of its neighbors. Its satellites, the
+	// neighbors next to no other hub, read their value as their stored value plus the
+	// pending gives. The hub's count of satellite values tells how many satellites cross
+	// zero with every move of the hub, so the number of debtors stays exact. The pending
+	// gives are flushed into the values and the debtor list only when those are read as a
+	// whole. Counting the satellites on the first move after a flush and the flush itself
+	// cost O(degree) each, so hub moves are O(1) amortized over the moves in between, and
+	// never cost more than twice what they would have right away.
+	mutable std::vector<LazyHub> m_hubs;
+	mutable std::vector<uint32_t> m_dirtyHubs;
+
+	// Per node the hub it's a satellite of, the hub count plus the hub for hubs, NoHub or
+	// SharedHubs otherwise. Empty if there are no hubs.
+	HugePageVector<uint32_t> m_hubRoles;
+
+	// The debtors among the satellites of dirty hubs that the debtor list misses, less the
+	// ones it lists that are no longer in debt.
+	mutable int64_t m_hiddenDebtorCount = 0;
+
+	// Null unless enableStateHash was called.
+	std::shared_ptr<const StateHashKeys> m_stateHashKeys;
+	uint64_t m_stateHash = 0;
+
+	// Nodes that cross zero during giveAll and takeAll.
+	HugePageVector<NodeHandle> m_batchChanges;
+
+	__forceinline void addDebtor(NodeHandle node) const
+	{
+		m_debtorPositions[node] = (uint32_t)m_debtors.size();
+		m_debtors.push_back(node);
+	}
+
+	__forceinline void removeDebtor(NodeHandle node) const
+	{
+		const NodeHandle last = m_debtors.back();
+		m_debtors[m_debtorPositions[node]] = last;
+		m_debtorPositions[last] = m_debtorPositions[node];
+		m_debtors.pop_back();
+	}
+
+	__forceinline bool isListedDebtor(NodeHandle node) const
+	{
+		const uint32_t position = m_debtorPositions[node];
+		return position < m_debtors.size() && m_debtors[position] == node;
+	}
+
+	template<bool isTake>
+	void fireAll(Range<const NodeHandle> nodes, ThreadPool* threadPool);
+
+	void findHubs();
+	template<bool isTake>
+	void fireLazy(NodeHandle node);
+	void addToNode(NodeHandle node, NodeValue delta);
+	void addToSatellite(NodeHandle node, uint32_t hubIndex, NodeValue delta);
+
+	// Flushes the pending gives of the dirty hubs.
+	void settleHubs() const;
+
+	__forceinline void settle() const
+	{
+		if (!m_dirtyHubs.empty())
+		{
+			settleHubs();
+		}
+	}
 
 public:
 	Graph() = default;
-	Graph(const Graph& rhs);
 
+	// Both init and copy assignment reuse the buffers of the graph, so they don't allocate
+	// for graphs no larger than ones the graph held before.
 	void init(
 		const std::vector<NodeValue>& values,
 		const std::set<Edge>& edges);
 
+	// Shares an existing topology, such as one of the implicit ones.
+	void init(
+		const std::vector<NodeValue>& values,
+		std::shared_ptr<const GraphTopology> topology);
+
+	// Releases the topology and empties the graph, but keeps its buffers for the next init.
+	void reset();
+
 	void give(NodeHandle node);
 	void take(NodeHandle node);
 
+	// Gives from or takes at all of the nodes at once. The nodes must be distinct and
+	// pairwise non-adjacent, so that no move changes the value of another node of the batch.
+	// With a thread pool the neighbors are updated in parallel. The graph ends up the same,
+	// debtor order included, for any number of threads.
+	void giveAll(Range<const NodeHandle> nodes, ThreadPool* threadPool = nullptr);
+	void takeAll(Range<const NodeHandle> nodes, ThreadPool* threadPool = nullptr);
+
 	bool isSolvable() const;
-	bool isSolved() const;
 
-	__forceinline size_t size() const
+	__forceinline bool isSolved() const
 	{
-		return m_values.size();
+		return (int64_t)m_debtors.size() + m_hiddenDebtorCount == 0;
 	}
 
-	__forceinline const auto& values() const
+	// The nodes with a negative value, in no particular order. Invalidated by moves. Settles
+	// the lazy hubs, so like values it's not thread-safe after hub moves.
+	__forceinline const HugePageVector<NodeHandle>& debtors() const
 	{
-		return m_values;
+		settle();
+		return m_debtors;
 	}
 
-	__forceinline NodeValue getNodeValue(NodeHandle handle) const
+	// Starts maintaining the state hash. Costs O(V + E) once, and one addition per move
+	// from then on. Copies of the graph share the keys and keep hashing.
+	void enableStateHash();
+
+	__forceinline bool hasStateHash() const
 	{
-		assert(handle != NullNode);
-		return m_values[handle];
+		return m_stateHashKeys != nullptr;
 	}
 
-	__forceinline const auto& connections() const
+	// Equal for equal node values. Requires enableStateHash.
+	__forceinline uint64_t stateHash() const
 	{
-		return m_connections;
+		assert(m_stateHashKeys);
+		return m_stateHash;
 	}
 
-	__forceinline Range<NodeHandle>& getNodeConnections(NodeHandle handle)
+	__forceinline const StateHashKeys& stateHashKeys() const
 	{
-		assert(handle != NullNode);
-		return m_connections[handle];
+		assert(m_stateHashKeys);
+		return *m_stateHashKeys;
+	}
+
+	// The Laplacian of the topology, which all graphs on it share.
+	__forceinline const Laplacian& laplacian() const
+	{
+		return m_topology->laplacian();
+	}
+
+	__forceinline bool hasDanglingNodes() const
+	{
+		return m_topology->hasDanglingNodes();
+	}
+
+	__forceinline size_t size() const
+	{
+		return m_values.size();
+	}
+
+	__forceinline const GraphTopology& topology() const
+	{
+		assert(m_topology);
+		return *m_topology;
+	}
+
+	// Settles the lazy hubs, which costs as much as the hub moves since the last call would
+	// have, and isn't thread-safe after hub moves.
+	__forceinline const auto& values() const
+	{
+		settle();
+		return m_values;
 	}
 
-	__forceinline const Range<NodeHandle>& getNodeConnections(NodeHandle handle) const
+	__forceinline NodeValue getNodeValue(NodeHandle handle) const
 	{
 		assert(handle != NullNode);
-		return m_connections[handle];
+		// The stored values are exact while no hub has pending gives.
+		if (!m_dirtyHubs.empty() && m_hubRoles[handle] < m_hubs.size())
+		{
+			return m_values[handle] + m_hubs[m_hubRoles[handle]].pending;
+		}
+		return m_values[handle];
+	}
+
+	__forceinline NodeConnections getNodeConnections(NodeHandle handle) const
+	{
+		return m_topology->getNodeConnections(handle);
 	}
 };
\ No newline at end of file
@@ -0,0 +1,255 @@
+#include "GraphDecomposition.hpp"
+
+#include <algorithm>
+
+static constexpr uint32_t Undiscovered = std::numeric_limits<uint32_t>::max();
+static constexpr size_t NoBlock = std::numeric_limits<size_t>::max();
+
+void GraphDecomposition::decompose(const Graph& graph)
+{
+	findBlocks(graph);
+	splitValues(graph);
+	buildBlockGraphs();
+}
+
+void GraphDecomposition::findBlocks(const Graph& graph)
+{
+	const GraphTopology& topology = graph.topology();
+	const size_t size = graph.size();
+
+	m_discovery.assign(size, Undiscovered);
+	m_low.resize(size);
+	m_parents.assign(size, NullNode);
+	m_owners.assign(size, NoBlock);
+	m_localHandles.assign(size, NullNode);
+	m_frames.clear();
+	m_edgeStack.clear();
+	m_blocks.clear();
+	m_blockNodes.clear();
+	m_blockEdges.clear();
+
+	uint32_t time = 0;
+	for (NodeHandle root = 0; root < size; ++root)
+	{
+		if (m_discovery[root] != Undiscovered)
+		{
+			continue;
+		}
+
+		const size_t firstBlock = m_blocks.size();
+		m_discovery[root] = m_low[root] = time++;
+		m_frames.push_back({ root, 0 });
+
+		while (!m_frames.empty())
+		{
+			SearchFrame& frame = m_frames.back();
+			const NodeHandle node = frame.node;
+
+			if (frame.nextConnection < topology.degree(node))
+			{
+				const NodeHandle connection = topology.getNodeConnections(node)[frame.nextConnection++];
+				if (m_discovery[connection] == Undiscovered)
+				{
+					m_parents[connection] = node;
+					m_discovery[connection] = m_low[connection] = time++;
+					m_edgeStack.emplace_back(node, connection);
+					m_frames.push_back({ connection, 0 });
+				}
+				else if (connection != m_parents[node] && m_discovery[connection] < m_discovery[node])
+				{
+					m_low[node] = std::min(m_low[node], m_discovery[connection]);
+					m_edgeStack.emplace_back(node, connection);
+				}
+				continue;
+			}
+
+			m_frames.pop_back();
+			const NodeHandle parent = m_parents[node];
+			if (parent != NullNode)
+			{
+				m_low[parent] = std::min(m_low[parent], m_low[node]);
+				if (m_low[node] >= m_discovery[parent])
+				{
+					popBlock(parent, Edge(parent, node));
+				}
+			}
+		}
+
+		if (m_blocks.size() > firstBlock)
+		{
+			Block& rootBlock = m_blocks.back();
+			rootBlock.isRoot = true;
+			m_owners[rootBlock.attachment] = m_blocks.size() - 1;
+		}
+	}
+
+	for (Block& block : m_blocks)
+	{
+		if (!block.isRoot)
+		{
+			block.parent = m_owners[block.attachment];
+		}
+	}
+}
+
+void GraphDecomposition::addBlockNode(NodeHandle node)
+{
+	if (m_localHandles[node] == NullNode)
+	{
+		m_localHandles[node] = (NodeHandle)(m_blockNodes.size() - m_blocks.back().nodeBegin);
+		m_blockNodes.push_back(node);
+	}
+}
+
+void GraphDecomposition::popBlock(NodeHandle attachment, const Edge& lastEdge)
+{
+	const size_t blockIndex = m_blocks.size();
+	m_blocks.push_back({ m_blockNodes.size(), 0, m_blockEdges.size(), 0, attachment, NoBlock, false, 0, 0, 0 });
+
+	addBlockNode(attachment);
+	while (true)
+	{
+		const Edge edge = m_edgeStack.back();
+		m_edgeStack.pop_back();
+
+		addBlockNode(edge.a);
+		addBlockNode(edge.b);
+		m_blockEdges.emplace_back(m_localHandles[edge.a], m_localHandles[edge.b]);
+
+		if (edge.a == lastEdge.a && edge.b == lastEdge.b)
+		{
+			break;
+		}
+	}
+
+	Block& block = m_blocks.back();
+	block.nodeEnd = m_blockNodes.size();
+	block.edgeEnd = m_blockEdges.size();
+
+	for (size_t nodeIt = block.nodeBegin; nodeIt < block.nodeEnd; ++nodeIt)
+	{
+		const NodeHandle node = m_blockNodes[nodeIt];
+		m_localHandles[node] = NullNode;
+		if (node != attachment)
+		{
+			m_owners[node] = blockIndex;
+		}
+	}
+}
+
+void GraphDecomposition::splitValues(const Graph& graph)
+{
+	const size_t size = graph.size();
+
+	m_remainders.assign(graph.values().cbegin(), graph.values().cend());
+	m_childSurpluses.assign(size, 0);
+
+	// Children first: every block takes what it lacks of its genus from its attachment.
+	for (Block& block : m_blocks)
+	{
+		const int64_t genus = (int64_t)(block.edgeEnd - block.edgeBegin) - (int64_t)(block.nodeEnd - block.nodeBegin) + 1;
+
+		int64_t value = 0;
+		int64_t childSurplus = 0;
+		for (size_t nodeIt = block.nodeBegin + (block.isRoot ? 0 : 1); nodeIt < block.nodeEnd; ++nodeIt)
+		{
+			value += m_remainders[m_blockNodes[nodeIt]];
+			childSurplus += m_childSurpluses[m_blockNodes[nodeIt]];
+		}
+
+		if (block.isRoot)
+		{
+			block.surplus = value - genus;
+			continue;
+		}
+
+		block.share = std::max<int64_t>(genus - value, 0);
+		m_remainders[block.attachment] -= block.share;
+		block.surplus = value + block.share - genus;
+		block.subtreeSurplus = block.surplus + childSurplus;
+		m_childSurpluses[block.attachment] += block.subtreeSurplus;
+	}
+
+	// Parents first: a root that lacks dollars takes the surplus of the blocks below it,
+	// and every block that gives up more than its own surplus passes the demand on.
+	m_pendingDemands.assign(m_blocks.size(), 0);
+	for (size_t blockIt = m_blocks.size(); blockIt-- > 0;)
+	{
+		Block& block = m_blocks[blockIt];
+		if (block.isRoot)
+		{
+			m_pendingDemands[blockIt] = std::max<int64_t>(-block.surplus, 0);
+			continue;
+		}
+
+		const int64_t given = std::min(m_pendingDemands[block.parent], block.subtreeSurplus);
+		m_pendingDemands[block.parent] -= given;
+		block.share -= given;
+		m_remainders[block.attachment] += given;
+		m_pendingDemands[blockIt] = std::max<int64_t>(given - block.surplus, 0);
+	}
+}
+
+void GraphDecomposition::buildBlockGraphs()
+{
+	if (m_blockGraphs.size() < m_blocks.size())
+	{
+		m_blockGraphs.resize(m_blocks.size());
+	}
+
+	for (size_t blockIt = 0; blockIt < m_blocks.size(); ++blockIt)
+	{
+		const Block& block = m_blocks[blockIt];
+
+		m_values.clear();
+		for (size_t nodeIt = block.nodeBegin; nodeIt < block.nodeEnd; ++nodeIt)
+		{
+			const bool isShared = nodeIt == block.nodeBegin && !block.isRoot;
+			m_values.push_back((NodeValue)(isShared ? block.share : m_remainders[m_blockNodes[nodeIt]]));
+		}
+		m_edges.assign(m_blockEdges.cbegin() + block.edgeBegin, m_blockEdges.cbegin() + block.edgeEnd);
+
+		Graph& blockGraph = m_blockGraphs[blockIt];
+		blockGraph.reset();
+		blockGraph.init(m_values, m_topologies.build(m_values.size(), m_edges));
+	}
+
+	// Hand the topologies of unused graphs back to the pool.
+	for (size_t blockIt = m_blocks.size(); blockIt < m_blockGraphs.size(); ++blockIt)
+	{
+		m_blockGraphs[blockIt].reset();
+	}
+}
+
+void GraphDecomposition::merge(const std::vector<std::unique_ptr<SolverContext>>& contexts, size_t nodeCount, std::vector<int64_t>& outFirings)
+{
+	outFirings.assign(nodeCount, 0);
+
+	// Parents first, so that the firing of every attachment is known before the blocks
+	// that hang off it are shifted to match.
+	for (size_t blockIt = m_blocks.size(); blockIt-- > 0;)
+	{
+		const Block& block = m_blocks[blockIt];
+
+		m_localFirings.assign(block.nodeEnd - block.nodeBegin, 0);
+		for (const Move& move : contexts[blockIt]->moves())
+		{
+			m_localFirings[move.node] += move.type == Move::Give ? 1 : -1;
+		}
+
+		const int64_t offset = block.isRoot ? 0 : outFirings[block.attachment] - m_localFirings[0];
+		for (size_t nodeIt = block.isRoot ? 0 : 1; nodeIt < m_localFirings.size(); ++nodeIt)
+		{
+			outFirings[m_blockNodes[block.nodeBegin + nodeIt]] = m_localFirings[nodeIt] + offset;
+		}
+	}
+
+	m_sortedFirings.assign(outFirings.cbegin(), outFirings.cend());
+	const auto median = m_sortedFirings.begin() + m_sortedFirings.size() / 2;
+	std::nth_element(m_sortedFirings.begin(), median, m_sortedFirings.end());
+	const int64_t offset = *median;
+	for (int64_t& firing : outFirings)
+	{
+		firing -= offset;
+	}
+}
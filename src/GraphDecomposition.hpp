@@ -0,0 +1,100 @@
+#pragma once
+
+#include "Graph.hpp"
+#include "SolverCommon.hpp"
+
+#include <memory>
+#include <vector>
+
+// Splits a graph into its blocks, the biconnected components, for --decompose. Blocks only
+// share cut vertices, so a firing of every block, shifted to agree at the cut vertices,
+// is a firing of the whole graph, and every cut vertex ends up with the sum of what it
+// ends up with in its blocks. The dollars of a cut vertex are split between its blocks so
+// that every block is solvable on its own: blocks keep their own dollars and only draw on
+// a cut vertex for what they lack of their genus, unless the rest of the graph needs their
+// surplus. The blocks can then be solved independently, in parallel.
+class GraphDecomposition final
+{
+private:
+	// The blocks are found children first: a block hangs off the block that holds its
+	// attachment, the cut vertex closest to the root of the search, which is found later.
+	// The last block of a component is its root, and holds the root of the search.
+	struct Block
+	{
+		size_t nodeBegin;
+		size_t nodeEnd;
+		size_t edgeBegin;
+		size_t edgeEnd;
+		NodeHandle attachment;
+		size_t parent;
+		bool isRoot;
+
+		// The share of the attachment's dollars, what the block has beyond its genus, and
+		// the same for all blocks that hang off it, directly or not.
+		int64_t share;
+		int64_t surplus;
+		int64_t subtreeSurplus;
+	};
+
+	struct SearchFrame
+	{
+		NodeHandle node;
+		uint32_t nextConnection;
+	};
+
+	std::vector<Block> m_blocks;
+	// Global handles of the nodes of every block, the attachment first.
+	std::vector<NodeHandle> m_blockNodes;
+	// Edges of every block in local handles.
+	std::vector<Edge> m_blockEdges;
+	std::vector<Edge> m_edges;
+	std::vector<Graph> m_blockGraphs;
+	TopologyPool m_topologies;
+
+	// Tarjan's algorithm, without recursion so that long paths don't overflow the stack.
+	std::vector<uint32_t> m_discovery;
+	std::vector<uint32_t> m_low;
+	std::vector<NodeHandle> m_parents;
+	std::vector<SearchFrame> m_frames;
+	std::vector<Edge> m_edgeStack;
+
+	// Scratch: the block that owns every node, which is the parent block for a cut vertex,
+	// the local handle of every node in the block being built, and what is left of the
+	// value of every cut vertex once its child blocks took their shares.
+	std::vector<size_t> m_owners;
+	std::vector<NodeHandle> m_localHandles;
+	std::vector<int64_t> m_remainders;
+	std::vector<int64_t> m_childSurpluses;
+	std::vector<int64_t> m_pendingDemands;
+	std::vector<NodeValue> m_values;
+	std::vector<int64_t> m_localFirings;
+	std::vector<int64_t> m_sortedFirings;
+
+	void findBlocks(const Graph& graph);
+	void popBlock(NodeHandle attachment, const Edge& lastEdge);
+	void splitValues(const Graph& graph);
+	void addBlockNode(NodeHandle node);
+	void buildBlockGraphs();
+
+public:
+	GraphDecomposition() = default;
+	GraphDecomposition(const GraphDecomposition&) = delete;
+
+	// Reuses the buffers and topologies of the last decomposition.
+	void decompose(const Graph& graph);
+
+	__forceinline size_t blockCount() const
+	{
+		return m_blocks.size();
+	}
+
+	__forceinline const Graph& blockGraph(size_t index) const
+	{
+		assert(index < m_blocks.size());
+		return m_blockGraphs[index];
+	}
+
+	// Net firings, gives minus takes, of every node of the graph for the solved blocks, one
+	// context per block. Shifted by their median to need the fewest moves.
+	void merge(const std::vector<std::unique_ptr<SolverContext>>& contexts, size_t nodeCount, std::vector<int64_t>& outFirings);
+};
@@ -0,0 +1,187 @@
+#include "GraphHash.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+// Two multiply-mix lanes with different seeds, which together make a 128-bit hash.
+class Hasher final
+{
+private:
+	uint64_t m_low;
+	uint64_t m_high;
+
+	static uint64_t mix(uint64_t hash, uint64_t value)
+	{
+		hash ^= value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+		hash *= 0xff51afd7ed558ccdull;
+		return hash ^ (hash >> 33);
+	}
+
+public:
+	Hasher()
+		: m_low(0x243f6a8885a308d3ull)
+		, m_high(0x13198a2e03707344ull)
+	{
+	}
+
+	void add(uint64_t value)
+	{
+		m_low = mix(m_low, value);
+		m_high = mix(m_high, value ^ 0xa4093822299f31d0ull);
+	}
+
+	GraphHash finish() const
+	{
+		GraphHash hash;
+		hash.low = m_low;
+		hash.high = m_high;
+		return hash;
+	}
+};
+
+std::string GraphHash::toString() const
+{
+	static const char* digits = "0123456789abcdef";
+
+	std::string text(32, '0');
+	for (int digitIt = 0; digitIt < 16; ++digitIt)
+	{
+		text[15 - digitIt] = digits[(high >> (digitIt * 4)) & 0xf];
+		text[31 - digitIt] = digits[(low >> (digitIt * 4)) & 0xf];
+	}
+	return text;
+}
+
+// Start of the least rotation of a cyclic sequence, in O(n) comparisons.
+template<typename Values>
+static size_t findLeastRotation(const Values& values, size_t size)
+{
+	size_t i = 0;
+	size_t j = 1;
+	size_t k = 0;
+	while (i < size && j < size && k < size)
+	{
+		const NodeValue a = values((i + k) % size);
+		const NodeValue b = values((j + k) % size);
+		if (a == b)
+		{
+			++k;
+			continue;
+		}
+
+		if (a > b)
+		{
+			i += k + 1;
+		}
+		else
+		{
+			j += k + 1;
+		}
+
+		if (i == j)
+		{
+			++j;
+		}
+		k = 0;
+	}
+	return std::min(i, j);
+}
+
+static void hashRing(const Graph& graph, Hasher& hasher)
+{
+	const size_t size = graph.size();
+	const auto forward = [&graph] (size_t index) { return graph.getNodeValue((NodeHandle)index); };
+	const auto backward = [&graph, size] (size_t index) { return graph.getNodeValue((NodeHandle)(size - 1 - index)); };
+
+	const size_t forwardStart = findLeastRotation(forward, size);
+	const size_t backwardStart = findLeastRotation(backward, size);
+
+	bool isBackward = false;
+	for (size_t offset = 0; offset < size; ++offset)
+	{
+		const NodeValue a = forward((forwardStart + offset) % size);
+		const NodeValue b = backward((backwardStart + offset) % size);
+		if (a != b)
+		{
+			isBackward = b < a;
+			break;
+		}
+	}
+
+	for (size_t offset = 0; offset < size; ++offset)
+	{
+		const NodeValue value = isBackward ? backward((backwardStart + offset) % size) : forward((forwardStart + offset) % size);
+		hasher.add((uint64_t)(int64_t)value);
+	}
+}
+
+static void hashStar(const Graph& graph, Hasher& hasher)
+{
+	std::vector<NodeValue> leaves(graph.values().cbegin() + 1, graph.values().cend());
+	std::sort(leaves.begin(), leaves.end());
+
+	hasher.add((uint64_t)(int64_t)graph.getNodeValue(0));
+	for (const NodeValue value : leaves)
+	{
+		hasher.add((uint64_t)(int64_t)value);
+	}
+}
+
+static void hashLabelled(const Graph& graph, Hasher& hasher)
+{
+	const GraphTopology& topology = graph.topology();
+	for (NodeHandle node = 0; node < graph.size(); ++node)
+	{
+		hasher.add((uint64_t)(int64_t)graph.getNodeValue(node));
+		hasher.add(topology.forEachConnection(node, [&hasher] (NodeHandle connection) {
+			hasher.add(connection);
+		}));
+	}
+}
+
+GraphHash hashGraph(const Graph& graph)
+{
+	const GraphTopology& topology = graph.topology();
+
+	Hasher hasher;
+	hasher.add(topology.kind());
+	hasher.add(graph.size());
+	hasher.add(topology.edgeCount());
+
+	switch (topology.kind())
+	{
+	case GraphTopology::Ring:
+		hashRing(graph, hasher);
+		break;
+	case GraphTopology::Star:
+		hashStar(graph, hasher);
+		break;
+	default:
+		hashLabelled(graph, hasher);
+		break;
+	}
+	return hasher.finish();
+}
+
+uint64_t hashFile(const std::string& filename)
+{
+	std::ifstream is(filename, std::ios::binary);
+	if (!is)
+	{
+		return 0;
+	}
+
+	// FNV-1a.
+	uint64_t hash = 14695981039346656037ull;
+	char buffer[1 << 16];
+	while (is.read(buffer, sizeof(buffer)) || is.gcount() > 0)
+	{
+		for (std::streamsize byteIt = 0; byteIt < is.gcount(); ++byteIt)
+		{
+			hash ^= (uint8_t)buffer[byteIt];
+			hash *= 1099511628211ull;
+		}
+	}
+	return hash;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "Graph.hpp"
+
+#include <string>
+
+// 128-bit hash of a graph with its values, for the --cache. Isomorphic stars and rings hash
+// the same: a star is hashed with its leaves sorted by value, and a ring from the rotation
+// and direction that make its values the least sequence. Isomorphism of arbitrary graphs has
+// no cheap canonical form, so other graphs are hashed as they are labelled and only equal
+// instances hash the same.
+struct GraphHash
+{
+	uint64_t low = 0;
+	uint64_t high = 0;
+
+	bool operator==(const GraphHash& other) const
+	{
+		return low == other.low && high == other.high;
+	}
+
+	// 32 hex digits.
+	std::string toString() const;
+};
+
+GraphHash hashGraph(const Graph& graph);
+
+// Hash of a file's contents, 0 if it can't be read.
+uint64_t hashFile(const std::string& filename);
@@ -0,0 +1,217 @@
+#include "GraphPipeline.hpp"
+#include "TimelineRecorder.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+void generateGraph(const GraphGenerator& generator, GeneratorWorkspace& workspace, std::mt19937& random, size_t size, NodeValue minValue, NodeValue maxValue, Graph& outGraph)
+{
+	TIMELINE_SCOPE("generateGraph");
+
+	while (true)
+	{
+		// Hands the topology back to the pool before the generator builds the next one.
+		outGraph.reset();
+		GeneratorContext ctx(outGraph, random, workspace);
+
+		GeneratorParams params(size, minValue, maxValue);
+
+		{
+			TIMELINE_SCOPE("generate");
+			generator.generate(ctx, params);
+		}
+
+		// Make sure the graph is solvable and unsolved.
+		if (!outGraph.isSolvable())
+		{
+			//std::cout << "Unsolvable\n";
+			continue;
+		}
+		else if (outGraph.isSolved())
+		{
+			//std::cout << "Already solved\n";
+			continue;
+		}
+
+		//std::cout << "Done\n";
+		return;
+	};
+}
+
+GraphPipeline::GraphPipeline(std::vector<PipelineCell> cells, std::mt19937& random, NodeValue minValue, NodeValue maxValue, size_t depth, bool keepsRandomState)
+	: m_cells(std::move(cells))
+	, m_random(random)
+	, m_minValue(minValue)
+	, m_maxValue(maxValue)
+	, m_depth(depth)
+	, m_keepsRandomState(keepsRandomState)
+	, m_workspace(&m_threadPool)
+	, m_freeSlots(depth + 1)
+	, m_readySlots(std::max<size_t>(depth, 1))
+	, m_currentSlot(nullptr)
+	, m_currentTrial(0)
+	, m_attempt(0)
+	, m_requestedCell(0)
+{
+	// One slot more than the depth, for the graph being solved.
+	for (size_t slotIt = 0; slotIt < depth + 1; ++slotIt)
+	{
+		m_slots.push_back(std::make_unique<Slot>());
+		m_freeSlots.push(m_slots.back().get());
+	}
+
+	// Without a depth, the only slot holds no cell yet.
+	m_slots[0]->cellIndex = std::numeric_limits<size_t>::max();
+}
+
+GraphPipeline::~GraphPipeline()
+{
+	m_freeSlots.close();
+	m_readySlots.close();
+	if (m_thread.joinable())
+	{
+		m_thread.join();
+	}
+}
+
+void GraphPipeline::generate(size_t cellIndex, size_t trialIndex, size_t attempt, GeneratorWorkspace& workspace, Graph& outGraph)
+{
+	const PipelineCell& cell = m_cells[cellIndex];
+	if (cell.trialSeeds.empty())
+	{
+		generateGraph(*cell.generator, workspace, m_random, cell.graphSize, m_minValue, m_maxValue, outGraph);
+		return;
+	}
+
+	const uint64_t seed = cell.trialSeeds[trialIndex];
+	std::seed_seq seedSequence{ (uint32_t)seed, (uint32_t)(seed >> 32), (uint32_t)attempt };
+	std::mt19937 random(seedSequence);
+	generateGraph(*cell.generator, workspace, random, cell.graphSize, m_minValue, m_maxValue, outGraph);
+}
+
+void GraphPipeline::produce()
+{
+	if (TimelineRecorder* timeline = TimelineRecorder::active())
+	{
+		timeline->setThreadName("generator");
+	}
+
+	try
+	{
+		size_t cellIndex = 0;
+		size_t trialIndex = 0;
+		Slot* slot;
+		while (m_freeSlots.pop(slot))
+		{
+			if (m_requestedCell > cellIndex)
+			{
+				cellIndex = m_requestedCell;
+				trialIndex = 0;
+			}
+
+			// Seeded cells end with their last trial.
+			while (cellIndex < m_cells.size() && !m_cells[cellIndex].trialSeeds.empty() && trialIndex >= m_cells[cellIndex].trialSeeds.size())
+			{
+				++cellIndex;
+				trialIndex = 0;
+			}
+
+			if (cellIndex >= m_cells.size())
+			{
+				break;
+			}
+
+			generate(cellIndex, trialIndex, 0, m_workspace, slot->graph);
+			slot->cellIndex = cellIndex;
+			slot->trialIndex = trialIndex++;
+			if (m_keepsRandomState)
+			{
+				std::ostringstream randomState;
+				randomState << m_random;
+				slot->randomState = randomState.str();
+			}
+
+			if (!m_readySlots.push(slot))
+			{
+				break;
+			}
+		}
+	}
+	catch (...)
+	{
+		m_error = std::current_exception();
+	}
+
+	m_readySlots.close();
+}
+
+const Graph& GraphPipeline::next(size_t cellIndex)
+{
+	m_attempt = 0;
+	if (m_depth == 0)
+	{
+		m_currentTrial = m_slots[0]->cellIndex == cellIndex ? m_currentTrial + 1 : 0;
+		m_slots[0]->cellIndex = cellIndex;
+		generate(cellIndex, m_currentTrial, 0, m_workspace, m_slots[0]->graph);
+		return m_slots[0]->graph;
+	}
+
+	if (m_currentSlot)
+	{
+		m_freeSlots.push(m_currentSlot);
+		m_currentSlot = nullptr;
+	}
+
+	m_requestedCell = std::max<size_t>(m_requestedCell, cellIndex);
+	if (!m_thread.joinable())
+	{
+		m_thread = std::thread(&GraphPipeline::produce, this);
+	}
+
+	Slot* slot;
+	while (m_readySlots.pop(slot))
+	{
+		if (slot->cellIndex == cellIndex)
+		{
+			m_currentSlot = slot;
+			m_currentTrial = slot->trialIndex;
+			return slot->graph;
+		}
+
+		// Generated before the caller moved on to a later cell.
+		m_freeSlots.push(slot);
+	}
+
+	// The ready queue is only closed early if the generator failed, which happens-before
+	// the pop that found the queue closed.
+	if (m_error)
+	{
+		std::rethrow_exception(m_error);
+	}
+	throw std::logic_error("No graphs left in the pipeline");
+}
+
+const Graph& GraphPipeline::retry(size_t cellIndex)
+{
+	if (m_cells[cellIndex].trialSeeds.empty())
+	{
+		return next(cellIndex);
+	}
+
+	generate(cellIndex, m_currentTrial, ++m_attempt, m_retryWorkspace, m_retryGraph);
+	return m_retryGraph;
+}
+
+std::string GraphPipeline::randomState() const
+{
+	if (m_depth > 0)
+	{
+		return m_currentSlot ? m_currentSlot->randomState : std::string();
+	}
+
+	std::ostringstream randomState;
+	randomState << m_random;
+	return randomState.str();
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "Graph.hpp"
+#include "Generator.hpp"
+#include "BoundedQueue.hpp"
+#include "ThreadPool.hpp"
+
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Generates into outGraph until the graph is solvable and unsolved, reusing its buffers and
+// those of the workspace.
+void generateGraph(const GraphGenerator& generator, GeneratorWorkspace& workspace, std::mt19937& random, size_t size, NodeValue minValue, NodeValue maxValue, Graph& outGraph);
+
+// One (generator, size) cell of a sweep.
+struct PipelineCell
+{
+	const GraphGenerator* generator;
+	size_t graphSize;
+
+	// Seeds of the trials of the cell, in the order they're run, for sweeps with a --seed.
+	// Empty to draw every graph from the random generator of the pipeline instead.
+	std::vector<uint64_t> trialSeeds;
+};
+
+// Hands out the graphs of a sweep, cell by cell. With a depth of 0 every graph is generated
+// when it's asked for. Otherwise a thread of its own generates up to depth graphs ahead
+// into a bounded queue, so that generating the next graph overlaps with solving the current
+// one, and a sweep takes as long as the slower of the two instead of their sum. Graphs
+// generated for a cell that was finished in the meantime are dropped.
+//
+// Cells with trial seeds get one graph per seed, each from a random generator of its own,
+// so a trial gets the same graph no matter which process runs it or what ran before.
+class GraphPipeline final
+{
+private:
+	struct Slot
+	{
+		Graph graph;
+		size_t cellIndex = 0;
+		size_t trialIndex = 0;
+
+		// State of the random generator right after the graph, for checkpoints.
+		std::string randomState;
+	};
+
+	const std::vector<PipelineCell> m_cells;
+	std::mt19937& m_random;
+	const NodeValue m_minValue;
+	const NodeValue m_maxValue;
+	const size_t m_depth;
+	const bool m_keepsRandomState;
+
+	ThreadPool m_threadPool;
+	GeneratorWorkspace m_workspace;
+
+	// Slots cycle from the free queue to the generator, the ready queue and the caller of
+	// next, which hands its slot back on the following call.
+	std::vector<std::unique_ptr<Slot>> m_slots;
+	BoundedQueue<Slot*> m_freeSlots;
+	BoundedQueue<Slot*> m_readySlots;
+	Slot* m_currentSlot;
+	size_t m_currentTrial;
+	size_t m_attempt;
+	std::atomic<size_t> m_requestedCell;
+	std::exception_ptr m_error;
+	std::thread m_thread;
+
+	// Retries of seeded trials are generated when they're asked for, on the caller's thread.
+	GeneratorWorkspace m_retryWorkspace;
+	Graph m_retryGraph;
+
+	void produce();
+	void generate(size_t cellIndex, size_t trialIndex, size_t attempt, GeneratorWorkspace& workspace, Graph& outGraph);
+
+public:
+	// The random generator belongs to the pipeline until it's destroyed. Random states are
+	// only recorded if keepsRandomState is set.
+	GraphPipeline(std::vector<PipelineCell> cells, std::mt19937& random, NodeValue minValue, NodeValue maxValue, size_t depth, bool keepsRandomState);
+	GraphPipeline(const GraphPipeline&) = delete;
+	~GraphPipeline();
+
+	// The next graph of the cell, valid until the next call. Cells must be asked for in
+	// increasing order. Rethrows what the generator threw.
+	const Graph& next(size_t cellIndex);
+
+	// Another graph for the trial of the last call to next, after the solver failed on it.
+	const Graph& retry(size_t cellIndex);
+
+	// State of the random generator right after the graph returned by next, for resuming a
+	// sweep with the graph that follows it.
+	std::string randomState() const;
+};
@@ -0,0 +1,449 @@
+#include "GraphReduction.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+// Rounding towards negative infinity, for flows against the direction of a chain.
+static int64_t floorDiv(int64_t a, int64_t b)
+{
+	return a / b - (a % b != 0 && (a < 0) != (b < 0) ? 1 : 0);
+}
+
+void GraphReduction::reduce(const Graph& graph)
+{
+	m_graph = &graph;
+	pruneTrees();
+	findChains();
+	splitChains();
+	buildReducedGraph();
+}
+
+void GraphReduction::pruneTrees()
+{
+	const GraphTopology& topology = m_graph->topology();
+	const size_t size = m_graph->size();
+
+	m_values.assign(m_graph->values().cbegin(), m_graph->values().cend());
+	m_degrees.resize(size);
+	m_isPruned.assign(size, 0);
+	m_leafStack.clear();
+	m_prunedLeaves.clear();
+
+	for (NodeHandle node = 0; node < size; ++node)
+	{
+		m_degrees[node] = (uint32_t)topology.degree(node);
+		if (m_degrees[node] == 1)
+		{
+			m_leafStack.push_back(node);
+		}
+	}
+
+	while (!m_leafStack.empty())
+	{
+		const NodeHandle leaf = m_leafStack.back();
+		m_leafStack.pop_back();
+
+		NodeHandle parent = NullNode;
+		topology.forEachConnection(leaf, [this, &parent] (NodeHandle connection) {
+			if (!m_isPruned[connection])
+			{
+				parent = connection;
+			}
+		});
+
+		// Keep the last edge of a tree, so that no node is left without neighbors.
+		if (m_degrees[parent] == 1)
+		{
+			continue;
+		}
+
+		m_isPruned[leaf] = 1;
+		m_values[parent] += m_values[leaf];
+		m_prunedLeaves.push_back({ leaf, parent });
+
+		if (--m_degrees[parent] == 1)
+		{
+			m_leafStack.push_back(parent);
+		}
+	}
+}
+
+void GraphReduction::findChains()
+{
+	const GraphTopology& topology = m_graph->topology();
+	const size_t size = m_graph->size();
+
+	m_isKept.assign(size, 0);
+	m_isInChain.assign(size, 0);
+	m_chainNodes.clear();
+	m_chains.clear();
+
+	for (NodeHandle node = 0; node < size; ++node)
+	{
+		m_isKept[node] = !m_isPruned[node] && m_degrees[node] != 2;
+	}
+
+	for (NodeHandle node = 0; node < size; ++node)
+	{
+		if (!m_isKept[node])
+		{
+			continue;
+		}
+
+		topology.forEachConnection(node, [this, node] (NodeHandle connection) {
+			if (!m_isPruned[connection] && !m_isKept[connection] && !m_isInChain[connection])
+			{
+				walkChain(node, connection);
+			}
+		});
+	}
+
+	// What is left are cycles of degree-2 nodes only, such as a ring. Each keeps one node
+	// to hang off, and splitChains keeps two more.
+	for (NodeHandle node = 0; node < size; ++node)
+	{
+		if (m_isPruned[node] || m_isKept[node] || m_isInChain[node])
+		{
+			continue;
+		}
+
+		m_isKept[node] = 1;
+		NodeHandle next = NullNode;
+		topology.forEachConnection(node, [this, &next] (NodeHandle connection) {
+			if (!m_isPruned[connection])
+			{
+				next = connection;
+			}
+		});
+		walkChain(node, next);
+	}
+}
+
+void GraphReduction::walkChain(NodeHandle first, NodeHandle next)
+{
+	const GraphTopology& topology = m_graph->topology();
+	const uint32_t nodeBegin = (uint32_t)m_chainNodes.size();
+
+	NodeHandle previous = first;
+	while (!m_isKept[next])
+	{
+		m_isInChain[next] = 1;
+		m_chainNodes.push_back(next);
+
+		const NodeHandle node = next;
+		topology.forEachConnection(node, [this, previous, &next] (NodeHandle connection) {
+			if (connection != previous && !m_isPruned[connection])
+			{
+				next = connection;
+			}
+		});
+		previous = node;
+	}
+
+	m_chains.push_back({ first, next, nodeBegin, (uint32_t)m_chainNodes.size() - nodeBegin });
+}
+
+void GraphReduction::splitChains()
+{
+	// Sorted by their ends, so that chains between the same nodes are next to each other.
+	const auto endsOf = [] (const Chain& chain) {
+		return std::make_pair(std::min(chain.first, chain.last), std::max(chain.first, chain.last));
+	};
+
+	m_chainOrder.resize(m_chains.size());
+	std::iota(m_chainOrder.begin(), m_chainOrder.end(), 0);
+	std::sort(m_chainOrder.begin(), m_chainOrder.end(), [this, &endsOf] (uint32_t lhs, uint32_t rhs) {
+		return endsOf(m_chains[lhs]) < endsOf(m_chains[rhs]);
+	});
+
+	// Splitting only adds chains between a kept node of a chain and something else, which
+	// can't duplicate an edge, so the order stays valid.
+	const size_t chainCount = m_chainOrder.size();
+	std::pair<NodeHandle, NodeHandle> previousEnds(NullNode, NullNode);
+	for (size_t orderIt = 0; orderIt < chainCount; ++orderIt)
+	{
+		const uint32_t chainIndex = m_chainOrder[orderIt];
+		const Chain chain = m_chains[chainIndex];
+		const auto ends = endsOf(chain);
+
+		if (chain.first == chain.last)
+		{
+			// A simple graph has at least two nodes in a cycle besides the one it hangs off.
+			const uint32_t lastKept = 2 * chain.nodeCount / 3;
+			splitChain(chainIndex, lastKept);
+			splitChain(chainIndex, chain.nodeCount / 3);
+		}
+		else if (ends == previousEnds || areAdjacent(chain.first, chain.last))
+		{
+			splitChain(chainIndex, chain.nodeCount / 2);
+		}
+		previousEnds = ends;
+	}
+}
+
+void GraphReduction::splitChain(uint32_t chainIndex, uint32_t keptNodeIndex)
+{
+	Chain& chain = m_chains[chainIndex];
+	const NodeHandle keptNode = m_chainNodes[chain.nodeBegin + keptNodeIndex];
+	m_isKept[keptNode] = 1;
+	m_isInChain[keptNode] = 0;
+
+	const Chain rest = { keptNode, chain.last, chain.nodeBegin + keptNodeIndex + 1, chain.nodeCount - keptNodeIndex - 1 };
+	chain.last = keptNode;
+	chain.nodeCount = keptNodeIndex;
+	m_chains.push_back(rest);
+}
+
+bool GraphReduction::areAdjacent(NodeHandle a, NodeHandle b) const
+{
+	const GraphTopology& topology = m_graph->topology();
+	if (topology.degree(a) > topology.degree(b))
+	{
+		std::swap(a, b);
+	}
+
+	bool isAdjacent = false;
+	topology.forEachConnection(a, [b, &isAdjacent] (NodeHandle connection) {
+		isAdjacent |= connection == b;
+	});
+	return isAdjacent;
+}
+
+bool GraphReduction::settleChain(const Chain& chain, int64_t& spareDollars)
+{
+	const NodeHandle* const nodes = m_chainNodes.data() + chain.nodeBegin;
+	int64_t* const firings = m_chainFirings.data() + chain.nodeBegin;
+	int64_t* const values = m_chainValues.data() + chain.nodeBegin;
+	const uint32_t nodeCount = chain.nodeCount;
+
+	m_debtorStack.clear();
+	for (uint32_t nodeIt = 0; nodeIt < nodeCount; ++nodeIt)
+	{
+		firings[nodeIt] = 0;
+		values[nodeIt] = m_values[nodes[nodeIt]];
+		if (values[nodeIt] < 0)
+		{
+			m_debtorStack.push_back(nodeIt);
+		}
+	}
+
+	// A debtor takes until it has no debt left, which its neighbors pay for. That needs the
+	// fewest takes, and the ends pay for whatever the chain can't.
+	while (!m_debtorStack.empty())
+	{
+		const uint32_t nodeIt = m_debtorStack.back();
+		m_debtorStack.pop_back();
+		if (values[nodeIt] >= 0)
+		{
+			continue;
+		}
+
+		const int64_t takes = (1 - values[nodeIt]) / 2;
+		firings[nodeIt] -= takes;
+		values[nodeIt] += 2 * takes;
+		if (nodeIt > 0 && (values[nodeIt - 1] -= takes) < 0)
+		{
+			m_debtorStack.push_back(nodeIt - 1);
+		}
+		if (nodeIt + 1 < nodeCount && (values[nodeIt + 1] -= takes) < 0)
+		{
+			m_debtorStack.push_back(nodeIt + 1);
+		}
+	}
+
+	const int64_t keptDollars = std::accumulate(values, values + nodeCount, int64_t(0));
+	if (keptDollars > spareDollars)
+	{
+		return false;
+	}
+
+	spareDollars -= keptDollars;
+	return true;
+}
+
+void GraphReduction::buildReducedGraph()
+{
+	const GraphTopology& topology = m_graph->topology();
+	const size_t size = m_graph->size();
+
+	// The reduced graph is solvable as long as it has at least as many dollars as its genus,
+	// which is that of the graph. A chain that can't be settled within that stays as is.
+	int64_t spareDollars = -(int64_t)topology.genus();
+	for (NodeHandle node = 0; node < size; ++node)
+	{
+		spareDollars += m_isPruned[node] ? 0 : m_values[node];
+	}
+
+	m_chainFirings.resize(m_chainNodes.size());
+	m_chainValues.resize(m_chainNodes.size());
+	for (Chain& chain : m_chains)
+	{
+		if (chain.nodeCount > 0 && !settleChain(chain, spareDollars))
+		{
+			for (uint32_t nodeIt = chain.nodeBegin; nodeIt < chain.nodeBegin + chain.nodeCount; ++nodeIt)
+			{
+				m_isKept[m_chainNodes[nodeIt]] = 1;
+				m_isInChain[m_chainNodes[nodeIt]] = 0;
+			}
+			chain.nodeCount = 0;
+		}
+	}
+
+	m_reducedHandles.assign(size, NullNode);
+	m_reducedValues.clear();
+	for (NodeHandle node = 0; node < size; ++node)
+	{
+		if (m_isKept[node])
+		{
+			m_reducedHandles[node] = (NodeHandle)m_reducedValues.size();
+			m_reducedValues.push_back((NodeValue)m_values[node]);
+		}
+	}
+
+	m_reducedEdges.clear();
+	for (NodeHandle node = 0; node < size; ++node)
+	{
+		if (!m_isKept[node])
+		{
+			continue;
+		}
+
+		topology.forEachConnection(node, [this, node] (NodeHandle connection) {
+			if (node < connection && m_isKept[connection])
+			{
+				m_reducedEdges.emplace_back(m_reducedHandles[node], m_reducedHandles[connection]);
+			}
+		});
+	}
+
+	// The ends lose what the takes next to them took. Chains without nodes are edges between
+	// kept nodes, which were added above.
+	for (const Chain& chain : m_chains)
+	{
+		if (chain.nodeCount == 0)
+		{
+			continue;
+		}
+
+		const NodeHandle first = m_reducedHandles[chain.first];
+		const NodeHandle last = m_reducedHandles[chain.last];
+		m_reducedValues[first] += (NodeValue)m_chainFirings[chain.nodeBegin];
+		m_reducedValues[last] += (NodeValue)m_chainFirings[chain.nodeBegin + chain.nodeCount - 1];
+		m_reducedEdges.emplace_back(first, last);
+	}
+
+	m_reducedGraph.reset();
+	m_reducedGraph.init(m_reducedValues, m_topologies.build(m_reducedValues.size(), m_reducedEdges));
+}
+
+void GraphReduction::expand(const HugePageVector<Move>& moves, const Graph& solvedGraph, std::vector<int64_t>& outFirings)
+{
+	const size_t size = m_graph->size();
+
+	m_reducedFirings.assign(m_reducedGraph.size(), 0);
+	for (const Move& move : moves)
+	{
+		m_reducedFirings[move.node] += move.type == Move::Give ? 1 : -1;
+	}
+
+	// Whatever the reduced solution left at a root, its pruned neighbors don't have to pass on.
+	outFirings.assign(size, 0);
+	m_demands.assign(size, 0);
+	for (NodeHandle node = 0; node < size; ++node)
+	{
+		if (m_isKept[node])
+		{
+			const NodeHandle reducedNode = m_reducedHandles[node];
+			outFirings[node] = m_reducedFirings[reducedNode];
+			m_demands[node] = -(int64_t)solvedGraph.getNodeValue(reducedNode);
+		}
+	}
+
+	expandChains(outFirings);
+	expandTrees(outFirings);
+
+	m_sortedFirings.assign(outFirings.cbegin(), outFirings.cend());
+	const auto median = m_sortedFirings.begin() + m_sortedFirings.size() / 2;
+	std::nth_element(m_sortedFirings.begin(), median, m_sortedFirings.end());
+	const int64_t offset = *median;
+	for (int64_t& firing : outFirings)
+	{
+		firing -= offset;
+	}
+}
+
+void GraphReduction::expandChains(std::vector<int64_t>& firings)
+{
+	// On top of the firings that settle it, the chain passes on the flow over the reduced
+	// edge in k + 1 nearly equal steps, the larger ones first, so that the node after them
+	// gets a dollar rather than loses one. What the ends get instead of what the reduced
+	// solution left them changes their demands, which the trees hanging off them can
+	// cover, and the solver finishes whatever they don't.
+	for (const Chain& chain : m_chains)
+	{
+		if (chain.nodeCount == 0)
+		{
+			continue;
+		}
+
+		const int64_t nodeCount = chain.nodeCount;
+		const NodeHandle* const nodes = m_chainNodes.data() + chain.nodeBegin;
+		const int64_t edgeFlow = firings[chain.first] - firings[chain.last];
+		const int64_t step = floorDiv(edgeFlow, nodeCount + 1);
+		const int64_t largerSteps = edgeFlow - step * (nodeCount + 1);
+
+		for (int64_t nodeIt = 0; nodeIt < nodeCount; ++nodeIt)
+		{
+			const int64_t stepCount = nodeIt + 1;
+			const int64_t flowSoFar = step * stepCount + std::min(stepCount, largerSteps);
+			firings[nodes[nodeIt]] = firings[chain.first] - flowSoFar + m_chainFirings[chain.nodeBegin + nodeIt];
+			m_demands[nodes[nodeIt]] = -m_chainValues[chain.nodeBegin + nodeIt] - (stepCount == largerSteps ? 1 : 0);
+		}
+
+		m_demands[chain.first] -= edgeFlow - step - (largerSteps > 0 ? 1 : 0);
+		m_demands[chain.last] -= step - edgeFlow;
+	}
+}
+
+void GraphReduction::expandTrees(std::vector<int64_t>& firings)
+{
+	const Graph& graph = *m_graph;
+	const size_t size = graph.size();
+
+	// The flow over the edge from a pruned node to its parent is the difference of their
+	// firings. At first, every pruned node only passes on the debt of its subtree.
+	m_debtFlows.assign(size, 0);
+	for (const PrunedLeaf& leaf : m_prunedLeaves)
+	{
+		m_debtFlows[leaf.parent] += std::min<int64_t>(graph.getNodeValue(leaf.node) + m_debtFlows[leaf.node], 0);
+	}
+
+	// A root has to get all the dollars of its subtrees, less its own final value, for the
+	// reduced solution to hold. Whatever the debts don't cover is demanded from the surplus
+	// of the subtrees, first from the node itself and then from its children, which come
+	// after it in reverse pruning order.
+	for (NodeHandle node = 0; node < size; ++node)
+	{
+		if (!m_isPruned[node])
+		{
+			const int64_t subtreeValue = m_values[node] - graph.getNodeValue(node);
+			m_demands[node] = std::max<int64_t>(m_demands[node] + subtreeValue - m_debtFlows[node], 0);
+		}
+	}
+
+	for (auto leafIt = m_prunedLeaves.crbegin(); leafIt != m_prunedLeaves.crend(); ++leafIt)
+	{
+		const NodeHandle node = leafIt->node;
+		const NodeHandle parent = leafIt->parent;
+
+		const int64_t available = graph.getNodeValue(node) + m_debtFlows[node];
+		const int64_t debtFlow = std::min<int64_t>(available, 0);
+
+		// The subtree can pass on everything it had when it was pruned.
+		const int64_t extra = std::min(m_demands[parent], m_values[node] - debtFlow);
+		m_demands[parent] -= extra;
+
+		firings[node] = firings[parent] + debtFlow + extra;
+		m_demands[node] = std::max<int64_t>(extra - std::max<int64_t>(available, 0), 0);
+	}
+}
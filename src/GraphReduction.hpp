@@ -0,0 +1,113 @@
+#pragma once
+
+#include "Graph.hpp"
+#include "SolverCommon.hpp"
+
+#include <vector>
+
+// Shrinks a graph before it is solved (--reduce), and turns the solution of the reduced
+// graph back into firings of the original one.
+//
+// Trees hanging off the graph are pruned leaf by leaf, every leaf handing its dollars to its
+// parent. That keeps the genus and the dollar total, so the reduced graph is solvable
+// whenever the original is, and the solution expands exactly: the leaves pass on their
+// debts, and as much of their surplus as the reduced solution spent at their parent.
+//
+// Chains of degree-2 nodes between two other nodes are then contracted into a single edge,
+// which keeps the genus too. Every chain first settles its debts on its own, with as few
+// takes as it needs, which may take dollars from its ends, and keeps what is left. A chain
+// whose surplus would leave the reduced graph with fewer dollars than its genus isn't
+// contracted. The flow of the reduced solution over the edge is spread evenly over the
+// chain, but a chain of k nodes conducts like k + 1 edges in a row, so only a
+// (k + 1)th of it arrives at the other end: whatever that end comes up short is left for
+// the solver to finish on the original graph. A chain that would duplicate an edge keeps
+// its middle node, and a cycle, such as a whole ring, keeps two of its nodes besides the
+// one it hangs off.
+//
+// The expansion is a net firing per node, so moves that cancel out are dropped, and firing
+// every node once changes nothing, so the firings are shifted to need the fewest moves.
+class GraphReduction final
+{
+private:
+	struct PrunedLeaf
+	{
+		NodeHandle node;
+		NodeHandle parent;
+	};
+
+	// The nodes between first and last are m_chainNodes[nodeBegin, nodeBegin + nodeCount),
+	// from first to last.
+	struct Chain
+	{
+		NodeHandle first;
+		NodeHandle last;
+		uint32_t nodeBegin;
+		uint32_t nodeCount;
+	};
+
+	const Graph* m_graph = nullptr;
+
+	// Values and degrees once the trees are pruned.
+	std::vector<int64_t> m_values;
+	std::vector<uint32_t> m_degrees;
+	std::vector<uint8_t> m_isPruned;
+	std::vector<NodeHandle> m_leafStack;
+	std::vector<PrunedLeaf> m_prunedLeaves;
+
+	// The nodes left after pruning that aren't inside a chain, and the chains between them.
+	// Every chain node has the net firing that settles its chain, and its value after it.
+	std::vector<uint8_t> m_isKept;
+	std::vector<uint8_t> m_isInChain;
+	std::vector<NodeHandle> m_chainNodes;
+	std::vector<int64_t> m_chainFirings;
+	std::vector<int64_t> m_chainValues;
+	std::vector<uint32_t> m_debtorStack;
+	std::vector<Chain> m_chains;
+	std::vector<uint32_t> m_chainOrder;
+
+	// Handle in the reduced graph of every kept node, NullNode for the others.
+	std::vector<NodeHandle> m_reducedHandles;
+	std::vector<NodeValue> m_reducedValues;
+	std::vector<Edge> m_reducedEdges;
+	TopologyPool m_topologies;
+	Graph m_reducedGraph;
+
+	// Scratch for expand.
+	std::vector<int64_t> m_reducedFirings;
+	std::vector<int64_t> m_debtFlows;
+	std::vector<int64_t> m_demands;
+	std::vector<int64_t> m_sortedFirings;
+
+	void pruneTrees();
+	void findChains();
+	void walkChain(NodeHandle first, NodeHandle next);
+	void splitChains();
+	void splitChain(uint32_t chainIndex, uint32_t keptNodeIndex);
+	bool areAdjacent(NodeHandle a, NodeHandle b) const;
+	bool settleChain(const Chain& chain, int64_t& spareDollars);
+	void buildReducedGraph();
+	void expandChains(std::vector<int64_t>& firings);
+	void expandTrees(std::vector<int64_t>& firings);
+
+public:
+	GraphReduction() = default;
+	GraphReduction(const GraphReduction&) = delete;
+
+	// The graph has to outlive the next expand. Reuses the buffers of the last reduction.
+	void reduce(const Graph& graph);
+
+	__forceinline const Graph& reducedGraph() const
+	{
+		return m_reducedGraph;
+	}
+
+	__forceinline size_t prunedNodeCount() const
+	{
+		return m_prunedLeaves.size();
+	}
+
+	// Net firings, gives minus takes, of every node of the original graph for the moves that
+	// took the reduced graph to solvedGraph. The original graph ends up solved if the
+	// reduced one did and the chains could carry the flows of their edges.
+	void expand(const HugePageVector<Move>& moves, const Graph& solvedGraph, std::vector<int64_t>& outFirings);
+};
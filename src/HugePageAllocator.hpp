@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#if __linux__
+#include <sys/mman.h>
+#endif
+
+// Buffers at least this large are aligned to a huge page, so that they can be backed by
+// transparent huge pages.
+constexpr size_t HugePageSize = 2 << 20;
+
+// Set by --huge-pages. The harness, the solvers and the generators are separate modules, so
+// the switch is passed in the environment rather than in a variable of one of them.
+constexpr const char* HugePagesVariable = "DOLLARGAME_HUGE_PAGES";
+
+inline bool hugePagesEnabled()
+{
+	const char* value = std::getenv(HugePagesVariable);
+	return value != nullptr && value[0] == '1';
+}
+
+// Allocates buffers of a huge page or more on huge page boundaries, and with --huge-pages
+// asks the kernel to back them with transparent huge pages. That saves page faults and TLB
+// misses on large graphs. Only the hint depends on the switch, so a buffer can be freed by
+// another module than the one that allocated it.
+template<typename T>
+class HugePageAllocator
+{
+public:
+	typedef T value_type;
+
+	HugePageAllocator() = default;
+
+	template<typename U>
+	HugePageAllocator(const HugePageAllocator<U>&)
+	{
+	}
+
+	T* allocate(size_t count)
+	{
+		const size_t size = count * sizeof(T);
+		if (size < HugePageSize)
+		{
+			return static_cast<T*>(::operator new(size));
+		}
+
+		void* data = ::operator new(size, std::align_val_t(HugePageSize));
+#if __linux__
+		if (hugePagesEnabled())
+		{
+			madvise(data, size, MADV_HUGEPAGE);
+		}
+#endif
+		return static_cast<T*>(data);
+	}
+
+	void deallocate(T* data, size_t count)
+	{
+		if (count * sizeof(T) < HugePageSize)
+		{
+			::operator delete(data);
+		}
+		else
+		{
+			::operator delete(data, std::align_val_t(HugePageSize));
+		}
+	}
+
+	template<typename U>
+	bool operator==(const HugePageAllocator<U>&) const
+	{
+		return true;
+	}
+
+	template<typename U>
+	bool operator!=(const HugePageAllocator<U>&) const
+	{
+		return false;
+	}
+};
+
+template<typename T>
+using HugePageVector = std::vector<T, HugePageAllocator<T>>;
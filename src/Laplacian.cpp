@@ -0,0 +1,404 @@
+#include "Laplacian.hpp"
+
+#include <immintrin.h>
+#include <numeric>
+#include <stdexcept>
+
+#if _WIN32
+#include <intrin.h>
+#define LAPLACIAN_AVX2
+#define LAPLACIAN_AVX512
+#elif __linux__
+#define LAPLACIAN_AVX2 __attribute__((target("avx2,fma")))
+#define LAPLACIAN_AVX512 __attribute__((target("avx512f")))
+#endif
+
+// The masked gathers, with every lane enabled, compile to the same instruction as the plain
+// ones, but don't start from an undefined vector, which GCC warns about.
+LAPLACIAN_AVX2 static inline __m256d gatherAvx2(const double* x, __m128i indices)
+{
+	const __m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+	return _mm256_mask_i32gather_pd(_mm256_setzero_pd(), x, indices, all, 8);
+}
+
+LAPLACIAN_AVX512 static inline __m512d gatherAvx512(const double* x, __m256i indices)
+{
+	return _mm512_mask_i32gather_pd(_mm512_setzero_pd(), 0xff, indices, x, 8);
+}
+
+// One row of a batched product, whose columns are stride entries apart.
+static inline void applyRowBatchScalar(const double* x, double* y, size_t vectorCount, NodeHandle row, size_t width, const uint32_t* columns, size_t stride)
+{
+	double* rowResults = y + row * vectorCount;
+	for (size_t vectorIt = 0; vectorIt < vectorCount; ++vectorIt)
+	{
+		rowResults[vectorIt] = (double)width * x[row * vectorCount + vectorIt];
+	}
+
+	for (size_t column = 0; column < width; ++column)
+	{
+		const double* neighborValues = x + columns[column * stride] * vectorCount;
+		for (size_t vectorIt = 0; vectorIt < vectorCount; ++vectorIt)
+		{
+			rowResults[vectorIt] -= neighborValues[vectorIt];
+		}
+	}
+}
+
+LAPLACIAN_AVX2 static inline void applyRowBatchAvx2(const double* x, double* y, size_t vectorCount, NodeHandle row, size_t width, const uint32_t* columns, size_t stride)
+{
+	const __m256d diagonal = _mm256_set1_pd((double)width);
+	for (size_t vectorIt = 0; vectorIt < vectorCount; vectorIt += 4)
+	{
+		__m256d sum = _mm256_setzero_pd();
+		for (size_t column = 0; column < width; ++column)
+		{
+			sum = _mm256_add_pd(sum, _mm256_loadu_pd(x + columns[column * stride] * vectorCount + vectorIt));
+		}
+
+		const __m256d rowValues = _mm256_loadu_pd(x + row * vectorCount + vectorIt);
+		_mm256_storeu_pd(y + row * vectorCount + vectorIt, _mm256_fmsub_pd(diagonal, rowValues, sum));
+	}
+}
+
+Laplacian::Laplacian(const GraphTopology& topology)
+	: m_size(topology.size())
+	, m_edgeCount(topology.edgeCount())
+	, m_chunkedRowCount(0)
+	, m_kernel(bestKernel())
+{
+	// The gathers take signed 32-bit indices.
+	if (m_size > (size_t)std::numeric_limits<int32_t>::max())
+	{
+		throw std::runtime_error("Graph too large for the Laplacian");
+	}
+
+	m_longRowOffsets.assign(1, 0);
+	for (NodeHandle node = 0; node < m_size; ++node)
+	{
+		if (topology.degree(node) > LongRowDegree)
+		{
+			m_longRows.push_back(node);
+			topology.forEachConnection(node, [this] (NodeHandle connection) {
+				m_longRowColumns.push_back(connection);
+			});
+			m_longRowOffsets.push_back(m_longRowColumns.size());
+		}
+		else
+		{
+			m_rows.push_back(node);
+		}
+	}
+
+	m_chunkedRowCount = m_rows.size();
+	const size_t chunkCount = (m_chunkedRowCount + ChunkSize - 1) / ChunkSize;
+	m_rows.resize(chunkCount * ChunkSize, NodeHandle(0));
+
+	for (size_t windowBegin = 0; windowBegin < m_chunkedRowCount; windowBegin += SortWindow)
+	{
+		const size_t windowEnd = std::min(windowBegin + SortWindow, m_chunkedRowCount);
+		std::stable_sort(m_rows.begin() + windowBegin, m_rows.begin() + windowEnd, [&topology] (NodeHandle a, NodeHandle b) {
+			return topology.degree(a) > topology.degree(b);
+		});
+	}
+
+	m_chunkOffsets.resize(chunkCount + 1);
+	m_chunkOffsets[0] = 0;
+	for (size_t chunkIt = 0; chunkIt < chunkCount; ++chunkIt)
+	{
+		size_t width = 0;
+		for (size_t rowIt = chunkIt * ChunkSize; rowIt < std::min((chunkIt + 1) * ChunkSize, m_chunkedRowCount); ++rowIt)
+		{
+			width = std::max(width, topology.degree(m_rows[rowIt]));
+		}
+		m_chunkOffsets[chunkIt + 1] = m_chunkOffsets[chunkIt] + width * ChunkSize;
+	}
+
+	m_columns.resize(m_chunkOffsets[chunkCount]);
+	for (size_t chunkIt = 0; chunkIt < chunkCount; ++chunkIt)
+	{
+		const size_t offset = m_chunkOffsets[chunkIt];
+		const size_t width = (m_chunkOffsets[chunkIt + 1] - offset) / ChunkSize;
+		for (size_t lane = 0; lane < ChunkSize; ++lane)
+		{
+			const size_t rowIt = chunkIt * ChunkSize + lane;
+			const NodeHandle row = m_rows[rowIt];
+
+			size_t column = 0;
+			if (rowIt < m_chunkedRowCount)
+			{
+				topology.forEachConnection(row, [this, offset, lane, &column] (NodeHandle connection) {
+					m_columns[offset + column * ChunkSize + lane] = connection;
+					++column;
+				});
+			}
+
+			for (; column < width; ++column)
+			{
+				m_columns[offset + column * ChunkSize + lane] = row;
+			}
+		}
+	}
+}
+
+Laplacian::Kernel Laplacian::bestKernel()
+{
+	static const Kernel kernel = [] {
+#if _WIN32
+		int info[4];
+		__cpuid(info, 1);
+		const bool hasOsAvx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 0x6) == 0x6;
+		const bool hasFma = (info[2] & (1 << 12)) != 0;
+		__cpuidex(info, 7, 0);
+		const bool hasAvx2 = hasOsAvx && hasFma && (info[1] & (1 << 5));
+		const bool hasAvx512 = hasOsAvx && (info[1] & (1 << 16)) && (_xgetbv(0) & 0xe6) == 0xe6;
+#elif __linux__
+		__builtin_cpu_init();
+		const bool hasAvx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+		const bool hasAvx512 = __builtin_cpu_supports("avx512f");
+#endif
+		return hasAvx512 ? Kernel::Avx512 : hasAvx2 ? Kernel::Avx2 : Kernel::Scalar;
+	}();
+	return kernel;
+}
+
+const char* Laplacian::kernelName(Kernel kernel)
+{
+	switch (kernel)
+	{
+	case Kernel::Scalar:
+		return "Scalar";
+	case Kernel::Avx2:
+		return "AVX2";
+	case Kernel::Avx512:
+		return "AVX-512";
+	}
+	return "";
+}
+
+void Laplacian::apply(const double* x, double* y, Kernel kernel) const
+{
+	// Kernels the CPU doesn't support fall back to the scalar one.
+	if (kernel > bestKernel())
+	{
+		kernel = Kernel::Scalar;
+	}
+
+	size_t scalarBegin = 0;
+	if (kernel == Kernel::Avx512)
+	{
+		applyChunksAvx512(x, y, fullChunkCount());
+		applyLongRowsAvx512(x, y);
+		scalarBegin = fullChunkCount();
+	}
+	else if (kernel == Kernel::Avx2)
+	{
+		applyChunksAvx2(x, y, fullChunkCount());
+		applyLongRowsAvx2(x, y);
+		scalarBegin = fullChunkCount();
+	}
+	else
+	{
+		applyLongRowsScalar(x, y);
+	}
+
+	applyChunksScalar(x, y, scalarBegin, chunkCount());
+}
+
+void Laplacian::applyChunksScalar(const double* x, double* y, size_t chunkBegin, size_t chunkEnd) const
+{
+	for (size_t chunkIt = chunkBegin; chunkIt < chunkEnd; ++chunkIt)
+	{
+		const size_t offset = m_chunkOffsets[chunkIt];
+		const size_t width = (m_chunkOffsets[chunkIt + 1] - offset) / ChunkSize;
+		for (size_t lane = 0; lane < ChunkSize && chunkIt * ChunkSize + lane < m_chunkedRowCount; ++lane)
+		{
+			const NodeHandle row = m_rows[chunkIt * ChunkSize + lane];
+
+			double sum = 0.0;
+			for (size_t column = 0; column < width; ++column)
+			{
+				sum += x[m_columns[offset + column * ChunkSize + lane]];
+			}
+			y[row] = (double)width * x[row] - sum;
+		}
+	}
+}
+
+LAPLACIAN_AVX2 void Laplacian::applyChunksAvx2(const double* x, double* y, size_t chunkEnd) const
+{
+	static_assert(ChunkSize == 8, "The AVX2 kernel takes a chunk as two vectors of four rows");
+
+	alignas(32) double results[ChunkSize];
+	for (size_t chunkIt = 0; chunkIt < chunkEnd; ++chunkIt)
+	{
+		const size_t offset = m_chunkOffsets[chunkIt];
+		const size_t width = (m_chunkOffsets[chunkIt + 1] - offset) / ChunkSize;
+		const uint32_t* columns = m_columns.data() + offset;
+
+		__m256d lowSum = _mm256_setzero_pd();
+		__m256d highSum = _mm256_setzero_pd();
+		for (size_t column = 0; column < width; ++column)
+		{
+			const __m128i lowIndices = _mm_loadu_si128((const __m128i*)(columns + column * ChunkSize));
+			const __m128i highIndices = _mm_loadu_si128((const __m128i*)(columns + column * ChunkSize + 4));
+			lowSum = _mm256_add_pd(lowSum, gatherAvx2(x, lowIndices));
+			highSum = _mm256_add_pd(highSum, gatherAvx2(x, highIndices));
+		}
+
+		const NodeHandle* rows = m_rows.data() + chunkIt * ChunkSize;
+		const __m256d diagonal = _mm256_set1_pd((double)width);
+		const __m256d lowRows = gatherAvx2(x, _mm_loadu_si128((const __m128i*)rows));
+		const __m256d highRows = gatherAvx2(x, _mm_loadu_si128((const __m128i*)(rows + 4)));
+		_mm256_store_pd(results, _mm256_fmsub_pd(diagonal, lowRows, lowSum));
+		_mm256_store_pd(results + 4, _mm256_fmsub_pd(diagonal, highRows, highSum));
+
+		// No scatter before AVX-512.
+		for (size_t lane = 0; lane < ChunkSize; ++lane)
+		{
+			y[rows[lane]] = results[lane];
+		}
+	}
+}
+
+LAPLACIAN_AVX512 void Laplacian::applyChunksAvx512(const double* x, double* y, size_t chunkEnd) const
+{
+	static_assert(ChunkSize == 8, "The AVX-512 kernel takes a chunk as one vector of eight rows");
+
+	for (size_t chunkIt = 0; chunkIt < chunkEnd; ++chunkIt)
+	{
+		const size_t offset = m_chunkOffsets[chunkIt];
+		const size_t width = (m_chunkOffsets[chunkIt + 1] - offset) / ChunkSize;
+		const uint32_t* columns = m_columns.data() + offset;
+
+		__m512d sum = _mm512_setzero_pd();
+		for (size_t column = 0; column < width; ++column)
+		{
+			const __m256i indices = _mm256_loadu_si256((const __m256i*)(columns + column * ChunkSize));
+			sum = _mm512_add_pd(sum, gatherAvx512(x, indices));
+		}
+
+		const __m256i rows = _mm256_loadu_si256((const __m256i*)(m_rows.data() + chunkIt * ChunkSize));
+		const __m512d result = _mm512_fmsub_pd(_mm512_set1_pd((double)width), gatherAvx512(x, rows), sum);
+		_mm512_i32scatter_pd(y, rows, result, 8);
+	}
+}
+
+void Laplacian::applyLongRowsScalar(const double* x, double* y) const
+{
+	for (size_t rowIt = 0; rowIt < m_longRows.size(); ++rowIt)
+	{
+		double sum = 0.0;
+		for (size_t columnIt = m_longRowOffsets[rowIt]; columnIt < m_longRowOffsets[rowIt + 1]; ++columnIt)
+		{
+			sum += x[m_longRowColumns[columnIt]];
+		}
+
+		const NodeHandle row = m_longRows[rowIt];
+		y[row] = (double)(m_longRowOffsets[rowIt + 1] - m_longRowOffsets[rowIt]) * x[row] - sum;
+	}
+}
+
+LAPLACIAN_AVX2 void Laplacian::applyLongRowsAvx2(const double* x, double* y) const
+{
+	alignas(32) double sums[4];
+	for (size_t rowIt = 0; rowIt < m_longRows.size(); ++rowIt)
+	{
+		const size_t columnBegin = m_longRowOffsets[rowIt];
+		const size_t columnEnd = m_longRowOffsets[rowIt + 1];
+
+		__m256d sum = _mm256_setzero_pd();
+		size_t columnIt = columnBegin;
+		for (; columnIt + 4 <= columnEnd; columnIt += 4)
+		{
+			sum = _mm256_add_pd(sum, gatherAvx2(x, _mm_loadu_si128((const __m128i*)(m_longRowColumns.data() + columnIt))));
+		}
+
+		_mm256_store_pd(sums, sum);
+		double rowSum = sums[0] + sums[1] + sums[2] + sums[3];
+		for (; columnIt < columnEnd; ++columnIt)
+		{
+			rowSum += x[m_longRowColumns[columnIt]];
+		}
+
+		const NodeHandle row = m_longRows[rowIt];
+		y[row] = (double)(columnEnd - columnBegin) * x[row] - rowSum;
+	}
+}
+
+LAPLACIAN_AVX512 void Laplacian::applyLongRowsAvx512(const double* x, double* y) const
+{
+	alignas(64) double sums[8];
+	for (size_t rowIt = 0; rowIt < m_longRows.size(); ++rowIt)
+	{
+		const size_t columnBegin = m_longRowOffsets[rowIt];
+		const size_t columnEnd = m_longRowOffsets[rowIt + 1];
+
+		__m512d sum = _mm512_setzero_pd();
+		size_t columnIt = columnBegin;
+		for (; columnIt + 8 <= columnEnd; columnIt += 8)
+		{
+			sum = _mm512_add_pd(sum, gatherAvx512(x, _mm256_loadu_si256((const __m256i*)(m_longRowColumns.data() + columnIt))));
+		}
+
+		_mm512_store_pd(sums, sum);
+		double rowSum = std::accumulate(sums, sums + 8, 0.0);
+		for (; columnIt < columnEnd; ++columnIt)
+		{
+			rowSum += x[m_longRowColumns[columnIt]];
+		}
+
+		const NodeHandle row = m_longRows[rowIt];
+		y[row] = (double)(columnEnd - columnBegin) * x[row] - rowSum;
+	}
+}
+
+void Laplacian::applyBatch(const double* x, double* y, size_t vectorCount) const
+{
+	if (bestKernel() >= Kernel::Avx2 && vectorCount % 4 == 0)
+	{
+		applyBatchAvx2(x, y, vectorCount);
+	}
+	else
+	{
+		applyBatchScalar(x, y, vectorCount);
+	}
+}
+
+void Laplacian::applyBatchScalar(const double* x, double* y, size_t vectorCount) const
+{
+	for (size_t chunkIt = 0; chunkIt < chunkCount(); ++chunkIt)
+	{
+		const size_t offset = m_chunkOffsets[chunkIt];
+		const size_t width = (m_chunkOffsets[chunkIt + 1] - offset) / ChunkSize;
+		for (size_t lane = 0; lane < ChunkSize && chunkIt * ChunkSize + lane < m_chunkedRowCount; ++lane)
+		{
+			applyRowBatchScalar(x, y, vectorCount, m_rows[chunkIt * ChunkSize + lane], width, m_columns.data() + offset + lane, ChunkSize);
+		}
+	}
+
+	for (size_t rowIt = 0; rowIt < m_longRows.size(); ++rowIt)
+	{
+		const size_t offset = m_longRowOffsets[rowIt];
+		applyRowBatchScalar(x, y, vectorCount, m_longRows[rowIt], m_longRowOffsets[rowIt + 1] - offset, m_longRowColumns.data() + offset, 1);
+	}
+}
+
+LAPLACIAN_AVX2 void Laplacian::applyBatchAvx2(const double* x, double* y, size_t vectorCount) const
+{
+	for (size_t chunkIt = 0; chunkIt < chunkCount(); ++chunkIt)
+	{
+		const size_t offset = m_chunkOffsets[chunkIt];
+		const size_t width = (m_chunkOffsets[chunkIt + 1] - offset) / ChunkSize;
+		for (size_t lane = 0; lane < ChunkSize && chunkIt * ChunkSize + lane < m_chunkedRowCount; ++lane)
+		{
+			applyRowBatchAvx2(x, y, vectorCount, m_rows[chunkIt * ChunkSize + lane], width, m_columns.data() + offset + lane, ChunkSize);
+		}
+	}
+
+	for (size_t rowIt = 0; rowIt < m_longRows.size(); ++rowIt)
+	{
+		const size_t offset = m_longRowOffsets[rowIt];
+		applyRowBatchAvx2(x, y, vectorCount, m_longRows[rowIt], m_longRowOffsets[rowIt + 1] - offset, m_longRowColumns.data() + offset, 1);
+	}
+}
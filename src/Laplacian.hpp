@@ -0,0 +1,98 @@
+#pragma once
+
+#include "Graph.hpp"
+
+// The graph Laplacian L = D - A as a sparse matrix, for spectral and iterative solvers:
+// (L·x)[i] = degree(i) * x[i] - sum of x over the neighbors of i.
+//
+// The adjacency is stored in the SELL-C-sigma layout. Rows are sorted by degree within
+// windows of SortWindow rows and grouped into chunks of ChunkSize rows, and every chunk is
+// stored column by column, padded to the degree of its longest row. A SIMD lane then walks
+// one row, and a column of a chunk is a single gather. Rows are padded with their own index
+// and the diagonal is the chunk width, so padding cancels out without a value array.
+// Rows longer than LongRowDegree, such as the hub of a star, would pad their chunk to their
+// degree, so they are kept apart as plain rows and gathered along the row instead.
+class Laplacian final
+{
+public:
+	static constexpr size_t ChunkSize = 8;
+	static constexpr size_t SortWindow = 256;
+	static constexpr size_t LongRowDegree = 256;
+
+	enum class Kernel
+	{
+		Scalar,
+		Avx2,
+		Avx512,
+	};
+
+private:
+	size_t m_size;
+	size_t m_edgeCount;
+
+	// The node of every row of every chunk, 0 for the rows that pad the last chunk.
+	HugePageVector<NodeHandle> m_rows;
+	size_t m_chunkedRowCount;
+	// Where the columns of every chunk start, and one past the last chunk.
+	HugePageVector<size_t> m_chunkOffsets;
+	HugePageVector<uint32_t> m_columns;
+
+	// The rows longer than LongRowDegree, in compressed sparse row form.
+	HugePageVector<NodeHandle> m_longRows;
+	HugePageVector<size_t> m_longRowOffsets;
+	HugePageVector<uint32_t> m_longRowColumns;
+
+	Kernel m_kernel;
+
+	void applyChunksScalar(const double* x, double* y, size_t chunkBegin, size_t chunkEnd) const;
+	void applyChunksAvx2(const double* x, double* y, size_t chunkEnd) const;
+	void applyChunksAvx512(const double* x, double* y, size_t chunkEnd) const;
+	void applyLongRowsScalar(const double* x, double* y) const;
+	void applyLongRowsAvx2(const double* x, double* y) const;
+	void applyLongRowsAvx512(const double* x, double* y) const;
+	void applyBatchScalar(const double* x, double* y, size_t vectorCount) const;
+	void applyBatchAvx2(const double* x, double* y, size_t vectorCount) const;
+
+	__forceinline size_t chunkCount() const
+	{
+		return m_chunkOffsets.size() - 1;
+	}
+
+	// Chunks without padding rows, which the SIMD kernels take.
+	__forceinline size_t fullChunkCount() const
+	{
+		return m_chunkedRowCount / ChunkSize;
+	}
+
+public:
+	explicit Laplacian(const GraphTopology& topology);
+	Laplacian(const Laplacian&) = delete;
+
+	// The fastest kernel this CPU supports.
+	static Kernel bestKernel();
+	static const char* kernelName(Kernel kernel);
+
+	// y = L·x, with x and y of one value per node. They must not overlap.
+	__forceinline void apply(const double* x, double* y) const
+	{
+		apply(x, y, m_kernel);
+	}
+
+	void apply(const double* x, double* y, Kernel kernel) const;
+
+	// Y = L·X for vectorCount vectors at once, stored node by node: the values of node i are
+	// X[i * vectorCount] to X[i * vectorCount + vectorCount - 1]. Every neighbor is then a
+	// single contiguous load, which vectorizes over the vectors instead of the rows.
+	void applyBatch(const double* x, double* y, size_t vectorCount) const;
+
+	__forceinline size_t size() const
+	{
+		return m_size;
+	}
+
+	// Stored column entries, padding included, per nonzero of the adjacency.
+	__forceinline double fillRatio() const
+	{
+		return m_edgeCount > 0 ? (double)(m_columns.size() + m_longRowColumns.size()) / (double)(2 * m_edgeCount) : 1.0;
+	}
+};
@@ -0,0 +1,352 @@
+#include "MoveTrace.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+#if _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#elif __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+static constexpr uint64_t alignOffset(uint64_t offset, uint64_t alignment)
+{
+	return (offset + alignment - 1) / alignment * alignment;
+}
+
+MoveTraceWriter::MoveTraceWriter(const std::string& filename, const Graph& graph)
+	: m_activeChunk(0)
+	, m_moveCount(0)
+	, m_directIo(false)
+	, m_failed(false)
+	, m_pendingChunk(nullptr)
+	, m_pendingCount(0)
+	, m_closing(false)
+{
+#if _WIN32
+	const HANDLE file = CreateFileA(filename.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		throw std::runtime_error("Failed to create move trace " + filename);
+	}
+	m_file = (intptr_t)file;
+#elif __linux__
+	m_file = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (m_file < 0)
+	{
+		throw std::runtime_error("Failed to create move trace " + filename);
+	}
+#endif
+
+	const size_t nodeCount = graph.size();
+
+	std::vector<uint64_t> connectionOffsets;
+	std::vector<NodeHandle> adjacency;
+	connectionOffsets.reserve(nodeCount + 1);
+	connectionOffsets.push_back(0);
+	for (NodeHandle nodeIt = 0; nodeIt < nodeCount; ++nodeIt)
+	{
+		for (NodeHandle connection : graph.getNodeConnections(nodeIt))
+		{
+			adjacency.push_back(connection);
+		}
+		connectionOffsets.push_back(adjacency.size());
+	}
+
+	MoveTraceHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MoveTraceMagic, sizeof(header.magic));
+	header.version = MoveTraceVersion;
+	header.nodeCount = nodeCount;
+	header.edgeCount = adjacency.size() / 2;
+	header.moveCount = MoveTraceUnfinished;
+	header.valuesOffset = sizeof(MoveTraceHeader);
+	header.connectionOffsetsOffset = alignOffset(header.valuesOffset + nodeCount * sizeof(NodeValue), sizeof(uint64_t));
+	header.adjacencyOffset = header.connectionOffsetsOffset + connectionOffsets.size() * sizeof(uint64_t);
+	header.movesOffset = alignOffset(header.adjacencyOffset + adjacency.size() * sizeof(NodeHandle), MoveTraceBlockSize);
+
+	const uint8_t padding[sizeof(uint64_t)] = {};
+	const uint64_t valuesEnd = header.valuesOffset + nodeCount * sizeof(NodeValue);
+	const uint64_t adjacencyEnd = header.adjacencyOffset + adjacency.size() * sizeof(NodeHandle);
+	const std::vector<uint8_t> blockPadding(header.movesOffset - adjacencyEnd);
+
+	writeToFile(&header, sizeof(header));
+	writeToFile(graph.values().data(), nodeCount * sizeof(NodeValue));
+	writeToFile(padding, header.connectionOffsetsOffset - valuesEnd);
+	writeToFile(connectionOffsets.data(), connectionOffsets.size() * sizeof(uint64_t));
+	writeToFile(adjacency.data(), adjacency.size() * sizeof(NodeHandle));
+	writeToFile(blockPadding.data(), blockPadding.size());
+
+#if __linux__
+	// The move chunks start on a block boundary and are whole blocks, so they can bypass the
+	// page cache. Not every file system supports this, in which case we stay buffered.
+	const int flags = fcntl((int)m_file, F_GETFL);
+	m_directIo = flags != -1 && fcntl((int)m_file, F_SETFL, flags | O_DIRECT) == 0;
+#endif
+
+	for (auto& chunk : m_chunks)
+	{
+		chunk = static_cast<uint32_t*>(::operator new(ChunkSize * sizeof(uint32_t), std::align_val_t(MoveTraceBlockSize)));
+	}
+
+	m_cursor = m_chunks[m_activeChunk];
+	m_chunkEnd = m_cursor + ChunkSize;
+
+	m_writerThread = std::thread(&MoveTraceWriter::writerThread, this);
+}
+
+MoveTraceWriter::~MoveTraceWriter()
+{
+	close();
+}
+
+void MoveTraceWriter::waitForPendingChunk(std::unique_lock<std::mutex>& lock)
+{
+	m_condition.wait(lock, [this] { return m_pendingChunk == nullptr; });
+}
+
+void MoveTraceWriter::submitChunk()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	// The other chunk has to be on disk before it can be filled again.
+	waitForPendingChunk(lock);
+
+	m_pendingChunk = m_chunks[m_activeChunk];
+	m_pendingCount = m_cursor - m_chunks[m_activeChunk];
+	m_moveCount += m_pendingCount;
+
+	m_activeChunk ^= 1;
+	m_cursor = m_chunks[m_activeChunk];
+	m_chunkEnd = m_cursor + ChunkSize;
+
+	m_condition.notify_all();
+}
+
+void MoveTraceWriter::writerThread()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true)
+	{
+		m_condition.wait(lock, [this] { return m_pendingChunk != nullptr || m_closing; });
+		if (m_pendingChunk == nullptr)
+		{
+			return;
+		}
+
+		const uint32_t* chunk = m_pendingChunk;
+		const size_t count = m_pendingCount;
+
+		lock.unlock();
+		writeToFile(chunk, count * sizeof(uint32_t));
+		lock.lock();
+
+		m_pendingChunk = nullptr;
+		m_condition.notify_all();
+	}
+}
+
+void MoveTraceWriter::writeToFile(const void* data, size_t size)
+{
+	const uint8_t* it = static_cast<const uint8_t*>(data);
+	while (size > 0 && !m_failed)
+	{
+#if _WIN32
+		DWORD written = 0;
+		const DWORD request = (DWORD)std::min<size_t>(size, 1 << 30);
+		if (!WriteFile((HANDLE)m_file, it, request, &written, NULL))
+		{
+			m_failed = true;
+			break;
+		}
+#elif __linux__
+		const ssize_t written = write((int)m_file, it, size);
+		if (written <= 0)
+		{
+			m_failed = true;
+			break;
+		}
+#endif
+		it += written;
+		size -= written;
+	}
+}
+
+void MoveTraceWriter::close()
+{
+	if (!m_writerThread.joinable())
+	{
+		return;
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		waitForPendingChunk(lock);
+		m_closing = true;
+		m_condition.notify_all();
+	}
+	m_writerThread.join();
+
+	// The last chunk is usually not a whole number of blocks, so write it buffered.
+#if __linux__
+	if (m_directIo)
+	{
+		fcntl((int)m_file, F_SETFL, fcntl((int)m_file, F_GETFL) & ~O_DIRECT);
+	}
+#endif
+
+	const size_t tailCount = m_cursor - m_chunks[m_activeChunk];
+	writeToFile(m_chunks[m_activeChunk], tailCount * sizeof(uint32_t));
+	m_moveCount += tailCount;
+
+	const uint64_t moveCountOffset = offsetof(MoveTraceHeader, moveCount);
+#if _WIN32
+	LARGE_INTEGER offset;
+	offset.QuadPart = (LONGLONG)moveCountOffset;
+	DWORD written = 0;
+	if (!SetFilePointerEx((HANDLE)m_file, offset, NULL, FILE_BEGIN) ||
+		!WriteFile((HANDLE)m_file, &m_moveCount, sizeof(m_moveCount), &written, NULL))
+	{
+		m_failed = true;
+	}
+	CloseHandle((HANDLE)m_file);
+#elif __linux__
+	if (pwrite((int)m_file, &m_moveCount, sizeof(m_moveCount), moveCountOffset) != sizeof(m_moveCount))
+	{
+		m_failed = true;
+	}
+	::close((int)m_file);
+#endif
+
+	for (auto& chunk : m_chunks)
+	{
+		::operator delete(chunk, std::align_val_t(MoveTraceBlockSize));
+		chunk = nullptr;
+	}
+}
+
+MoveTraceReader::MoveTraceReader(const std::string& filename)
+	: m_data(nullptr)
+	, m_size(0)
+	, m_mapping(0)
+{
+#if _WIN32
+	const HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		throw std::runtime_error("Failed to open move trace " + filename);
+	}
+	m_file = (intptr_t)file;
+
+	LARGE_INTEGER size;
+	GetFileSizeEx(file, &size);
+	m_size = (size_t)size.QuadPart;
+
+	if (m_size >= sizeof(MoveTraceHeader))
+	{
+		const HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		m_mapping = (intptr_t)mapping;
+		m_data = mapping ? (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	}
+#elif __linux__
+	m_file = open(filename.c_str(), O_RDONLY);
+	if (m_file < 0)
+	{
+		throw std::runtime_error("Failed to open move trace " + filename);
+	}
+
+	struct stat st;
+	fstat((int)m_file, &st);
+	m_size = (size_t)st.st_size;
+
+	if (m_size >= sizeof(MoveTraceHeader))
+	{
+		void* data = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, (int)m_file, 0);
+		m_data = data != MAP_FAILED ? (const uint8_t*)data : nullptr;
+	}
+#endif
+
+	if (m_data == nullptr)
+	{
+		unmap();
+		throw std::runtime_error("Failed to map move trace " + filename);
+	}
+
+	m_header = (const MoveTraceHeader*)m_data;
+	if (memcmp(m_header->magic, MoveTraceMagic, sizeof(MoveTraceMagic)) != 0 ||
+		m_header->version != MoveTraceVersion ||
+		m_header->movesOffset > m_size)
+	{
+		unmap();
+		throw std::runtime_error(filename + " is not a valid move trace");
+	}
+
+	if (isFinished())
+	{
+		m_moveCount = m_header->moveCount;
+	}
+	else
+	{
+		m_moveCount = (m_size - m_header->movesOffset) / sizeof(uint32_t);
+	}
+}
+
+MoveTraceReader::~MoveTraceReader()
+{
+	unmap();
+}
+
+void MoveTraceReader::unmap()
+{
+#if _WIN32
+	if (m_data)
+	{
+		UnmapViewOfFile(m_data);
+	}
+	if (m_mapping)
+	{
+		CloseHandle((HANDLE)m_mapping);
+	}
+	if (m_file != -1)
+	{
+		CloseHandle((HANDLE)m_file);
+	}
+#elif __linux__
+	if (m_data)
+	{
+		munmap((void*)m_data, m_size);
+	}
+	if (m_file >= 0)
+	{
+		::close((int)m_file);
+	}
+#endif
+	m_data = nullptr;
+	m_mapping = 0;
+	m_file = -1;
+}
+
+void MoveTraceReader::initGraph(Graph& graph) const
+{
+	const auto offsets = connectionOffsets();
+	const auto connections = adjacency();
+
+	std::set<Edge> edges;
+	for (NodeHandle nodeIt = 0; nodeIt < nodeCount(); ++nodeIt)
+	{
+		for (uint64_t connectionIt = offsets[nodeIt]; connectionIt < offsets[nodeIt + 1]; ++connectionIt)
+		{
+			if (nodeIt < connections[connectionIt])
+			{
+				edges.emplace(nodeIt, connections[connectionIt]);
+			}
+		}
+	}
+
+	graph.init(std::vector<NodeValue>(values().begin(), values().end()), edges);
+}
\ No newline at end of file
@@ -0,0 +1,174 @@
+#pragma once
+
+#include "Graph.hpp"
+
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Binary move trace file layout (little-endian):
+//
+//   MoveTraceHeader
+//   NodeValue  values[nodeCount]                initial node values
+//   uint64_t   connectionOffsets[nodeCount + 1] CSR offsets into the adjacency
+//   NodeHandle adjacency[2 * edgeCount]
+//   (zero padding up to movesOffset, which is a multiple of MoveTraceBlockSize)
+//   uint32_t   moves[moveCount]                 (node << 1) | type
+//
+// A trace that was never closed keeps moveCount at MoveTraceUnfinished. Its moves then
+// run until the end of the file.
+constexpr char MoveTraceMagic[8] = { 'D', 'G', 'T', 'R', 'A', 'C', 'E', '\0' };
+constexpr uint32_t MoveTraceVersion = 1;
+constexpr uint64_t MoveTraceUnfinished = std::numeric_limits<uint64_t>::max();
+constexpr size_t MoveTraceBlockSize = 4096;
+
+struct MoveTraceHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t reserved;
+	uint64_t nodeCount;
+	uint64_t edgeCount;
+	uint64_t moveCount;
+	uint64_t valuesOffset;
+	uint64_t connectionOffsetsOffset;
+	uint64_t adjacencyOffset;
+	uint64_t movesOffset;
+};
+
+inline uint32_t encodeTraceMove(uint32_t type, NodeHandle node)
+{
+	assert(node < (1u << 31));
+	return (node << 1) | type;
+}
+
+inline uint32_t decodeTraceMoveType(uint32_t record)
+{
+	return record & 1;
+}
+
+inline NodeHandle decodeTraceMoveNode(uint32_t record)
+{
+	return record >> 1;
+}
+
+// Streams moves to a trace file without keeping them in memory. Moves are appended to one
+// of two chunks while a background thread writes the other one to disk, so the solver
+// thread only waits if the disk falls a full chunk behind. On Linux the chunks are written
+// with O_DIRECT when the file system supports it.
+class MoveTraceWriter final
+{
+public:
+	// Number of moves per chunk. A chunk is 4 MiB, a whole number of blocks.
+	static constexpr size_t ChunkSize = 1 << 20;
+
+private:
+	uint32_t* m_chunks[2];
+	size_t m_activeChunk;
+	uint32_t* m_cursor;
+	uint32_t* m_chunkEnd;
+	uint64_t m_moveCount;
+
+	intptr_t m_file;
+	bool m_directIo;
+	bool m_failed;
+
+	std::thread m_writerThread;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	const uint32_t* m_pendingChunk;
+	size_t m_pendingCount;
+	bool m_closing;
+
+	void submitChunk();
+	void waitForPendingChunk(std::unique_lock<std::mutex>& lock);
+	void writerThread();
+	void writeToFile(const void* data, size_t size);
+
+public:
+	MoveTraceWriter(const std::string& filename, const Graph& graph);
+	MoveTraceWriter(const MoveTraceWriter&) = delete;
+	~MoveTraceWriter();
+
+	__forceinline void append(uint32_t record)
+	{
+		if (m_cursor == m_chunkEnd)
+		{
+			submitChunk();
+		}
+		*m_cursor++ = record;
+	}
+
+	// Flushes the remaining moves and finalizes the header. Called by the destructor.
+	void close();
+
+	// True if any write to the trace file failed.
+	__forceinline bool failed() const
+	{
+		return m_failed;
+	}
+};
+
+// Read-only memory mapping of a trace file.
+class MoveTraceReader final
+{
+private:
+	const uint8_t* m_data;
+	size_t m_size;
+	intptr_t m_file;
+	intptr_t m_mapping;
+
+	const MoveTraceHeader* m_header;
+	uint64_t m_moveCount;
+
+	void unmap();
+
+public:
+	MoveTraceReader(const std::string& filename);
+	MoveTraceReader(const MoveTraceReader&) = delete;
+	~MoveTraceReader();
+
+	__forceinline size_t nodeCount() const
+	{
+		return (size_t)m_header->nodeCount;
+	}
+
+	__forceinline size_t edgeCount() const
+	{
+		return (size_t)m_header->edgeCount;
+	}
+
+	__forceinline size_t moveCount() const
+	{
+		return (size_t)m_moveCount;
+	}
+
+	__forceinline bool isFinished() const
+	{
+		return m_header->moveCount != MoveTraceUnfinished;
+	}
+
+	__forceinline Range<const NodeValue> values() const
+	{
+		return Range<const NodeValue>((const NodeValue*)(m_data + m_header->valuesOffset), nodeCount());
+	}
+
+	__forceinline Range<const uint64_t> connectionOffsets() const
+	{
+		return Range<const uint64_t>((const uint64_t*)(m_data + m_header->connectionOffsetsOffset), nodeCount() + 1);
+	}
+
+	__forceinline Range<const NodeHandle> adjacency() const
+	{
+		return Range<const NodeHandle>((const NodeHandle*)(m_data + m_header->adjacencyOffset), edgeCount() * 2);
+	}
+
+	__forceinline Range<const uint32_t> moves() const
+	{
+		return Range<const uint32_t>((const uint32_t*)(m_data + m_header->movesOffset), moveCount());
+	}
+
+	// Rebuilds the initial graph stored in the trace.
+	void initGraph(Graph& graph) const;
+};
\ No newline at end of file
@@ -0,0 +1,228 @@
+#include "Regression.hpp"
+#include "Statistics.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <map>
+#include <tuple>
+#include <cmath>
+#include <stdexcept>
+
+static const char* BaselineHeader = "# DollarGame regression baseline 1";
+
+typedef std::tuple<std::string, std::string, size_t> CellKey;
+
+struct CellSamples
+{
+	std::vector<double> seconds;
+	std::vector<double> moveCounts;
+	size_t failures = 0;
+};
+
+static std::map<CellKey, CellSamples> groupByCell(const std::vector<RegressionSample>& samples)
+{
+	std::map<CellKey, CellSamples> cells;
+	for (const auto& sample : samples)
+	{
+		auto& cell = cells[CellKey(sample.solver, sample.generator, sample.graphSize)];
+		if (sample.solved)
+		{
+			cell.seconds.push_back(sample.seconds);
+			cell.moveCounts.push_back((double)sample.moveCount);
+		}
+		else
+		{
+			++cell.failures;
+		}
+	}
+	return cells;
+}
+
+void writeBaseline(const std::string& filename, const std::vector<RegressionSample>& samples)
+{
+	std::ofstream os(filename);
+	if (!os)
+	{
+		throw std::runtime_error("Failed to write baseline " + filename);
+	}
+
+	os << BaselineHeader << '\n';
+	os << "solver;generator;size;trial;solved;seconds;moves\n";
+	os << std::setprecision(9);
+	for (const auto& sample : samples)
+	{
+		os << sample.solver << ';'
+			<< sample.generator << ';'
+			<< sample.graphSize << ';'
+			<< sample.trial << ';'
+			<< (sample.solved ? 1 : 0) << ';'
+			<< sample.seconds << ';'
+			<< sample.moveCount << '\n';
+	}
+}
+
+std::vector<RegressionSample> readBaseline(const std::string& filename)
+{
+	std::ifstream is(filename);
+	if (!is)
+	{
+		throw std::runtime_error("Failed to read baseline " + filename);
+	}
+
+	std::string line;
+	if (!std::getline(is, line) || line != BaselineHeader || !std::getline(is, line))
+	{
+		throw std::runtime_error(filename + " is not a regression baseline");
+	}
+
+	std::vector<RegressionSample> samples;
+	while (std::getline(is, line))
+	{
+		if (line.empty())
+		{
+			continue;
+		}
+
+		std::vector<std::string> fields;
+		std::istringstream ls(line);
+		std::string field;
+		while (std::getline(ls, field, ';'))
+		{
+			fields.push_back(field);
+		}
+
+		if (fields.size() != 7)
+		{
+			throw std::runtime_error("Malformed baseline line: " + line);
+		}
+
+		RegressionSample sample;
+		sample.solver = fields[0];
+		sample.generator = fields[1];
+		sample.graphSize = std::stoull(fields[2]);
+		sample.trial = std::stoull(fields[3]);
+		sample.solved = fields[4] == "1";
+		sample.seconds = std::stod(fields[5]);
+		sample.moveCount = std::stoull(fields[6]);
+		samples.push_back(sample);
+	}
+	return samples;
+}
+
+size_t compareToBaseline(
+	const std::vector<RegressionSample>& baseline,
+	const std::vector<RegressionSample>& current,
+	double threshold,
+	double significance,
+	std::ostream& os)
+{
+	const auto baselineCells = groupByCell(baseline);
+	const auto currentCells = groupByCell(current);
+
+	// Per solver: sum of log time ratios and the number of cells, for the geometric mean.
+	std::map<std::string, std::pair<double, size_t>> solverSpeed;
+
+	os << std::left
+		<< std::setw(16) << "solver"
+		<< std::setw(12) << "generator"
+		<< std::right
+		<< std::setw(10) << "size"
+		<< std::setw(14) << "base ms"
+		<< std::setw(14) << "current ms"
+		<< std::setw(9) << "ratio"
+		<< std::setw(9) << "p"
+		<< std::setw(14) << "base moves"
+		<< std::setw(14) << "cur moves"
+		<< "  status\n";
+
+	size_t regressionCount = 0;
+	for (const auto& baselineCell : baselineCells)
+	{
+		const auto& key = baselineCell.first;
+		const auto& base = baselineCell.second;
+
+		os << std::left
+			<< std::setw(16) << std::get<0>(key)
+			<< std::setw(12) << std::get<1>(key)
+			<< std::right
+			<< std::setw(10) << std::get<2>(key);
+
+		const auto currentIt = currentCells.find(key);
+		if (currentIt == currentCells.cend())
+		{
+			os << "  REGRESSED (not run)\n";
+			++regressionCount;
+			continue;
+		}
+
+		const auto& cur = currentIt->second;
+
+		std::string status = "ok";
+		bool regressed = false;
+
+		const double baseTime = median(base.seconds);
+		const double curTime = median(cur.seconds);
+		const double timeRatio = baseTime > 0.0 ? curTime / baseTime : 1.0;
+		const double timeP = mannWhitneyPValue(base.seconds, cur.seconds);
+
+		const double baseMoves = mean(base.moveCounts);
+		const double curMoves = mean(cur.moveCounts);
+		const double moveRatio = baseMoves > 0.0 ? curMoves / baseMoves : 1.0;
+		const double moveP = mannWhitneyPValue(base.moveCounts, cur.moveCounts);
+
+		if (cur.failures > base.failures)
+		{
+			status = "REGRESSED (failures " + std::to_string(base.failures) + " -> " + std::to_string(cur.failures) + ")";
+			regressed = true;
+		}
+		else if (timeRatio > 1.0 + threshold && timeP < significance)
+		{
+			status = "REGRESSED (time)";
+			regressed = true;
+		}
+		else if (moveRatio > 1.0 + threshold && moveP < significance)
+		{
+			status = "REGRESSED (moves)";
+			regressed = true;
+		}
+		else if (timeRatio < 1.0 / (1.0 + threshold) && timeP < significance)
+		{
+			status = "improved";
+		}
+		else if (cur.seconds.empty())
+		{
+			status = "ok (no solves)";
+		}
+
+		if (baseTime > 0.0 && curTime > 0.0)
+		{
+			auto& speed = solverSpeed[std::get<0>(key)];
+			speed.first += std::log(timeRatio);
+			++speed.second;
+		}
+
+		os << std::fixed
+			<< std::setw(14) << std::setprecision(3) << baseTime * 1000.0
+			<< std::setw(14) << std::setprecision(3) << curTime * 1000.0
+			<< std::setw(9) << std::setprecision(2) << timeRatio
+			<< std::setw(9) << std::setprecision(3) << timeP
+			<< std::setw(14) << std::setprecision(1) << baseMoves
+			<< std::setw(14) << std::setprecision(1) << curMoves
+			<< "  " << status << '\n';
+
+		if (regressed)
+		{
+			++regressionCount;
+		}
+	}
+
+	os << "\nSpeedup per solver (geometric mean of baseline/current median time):\n\n";
+	for (const auto& speed : solverSpeed)
+	{
+		const double ratio = std::exp(speed.second.first / (double)speed.second.second);
+		os << "  " << std::left << std::setw(16) << speed.first << std::right << std::fixed << std::setprecision(2) << 1.0 / ratio << "x\n";
+	}
+
+	return regressionCount;
+}
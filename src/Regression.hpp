@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <ostream>
+
+// One timed solve of the regression benchmark.
+struct RegressionSample
+{
+	std::string solver;
+	std::string generator;
+	size_t graphSize;
+	size_t trial;
+	bool solved;
+	double seconds;
+	size_t moveCount;
+};
+
+void writeBaseline(const std::string& filename, const std::vector<RegressionSample>& samples);
+std::vector<RegressionSample> readBaseline(const std::string& filename);
+
+// Compares the samples of every (solver, generator, size) cell against the baseline and
+// prints a report. A cell regresses if its median solve time or mean move count grew by more
+// than the threshold (0.3 = 30%) and a Mann-Whitney U test rejects equal distributions at
+// the given significance level, if it failed more solves than the baseline, or if it is
+// missing from the current samples.
+// Returns the number of regressed cells.
+size_t compareToBaseline(
+	const std::vector<RegressionSample>& baseline,
+	const std::vector<RegressionSample>& current,
+	double threshold,
+	double significance,
+	std::ostream& os);
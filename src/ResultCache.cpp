@@ -0,0 +1,84 @@
+#include "ResultCache.hpp"
+
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+static const char* ResultCacheHeader = "# DollarGame result cache 1";
+
+std::string ResultCache::makeKey(const std::string& solver, uint64_t moduleHash, const GraphHash& graphHash)
+{
+	std::ostringstream key;
+	key << solver << ' ' << std::hex << std::setw(16) << std::setfill('0') << moduleHash << ' ' << graphHash.toString();
+	return key.str();
+}
+
+ResultCache::ResultCache(const std::string& filename)
+{
+	bool hasHeader = false;
+	{
+		std::ifstream is(filename);
+		std::string line;
+		if (is && std::getline(is, line))
+		{
+			if (line != ResultCacheHeader)
+			{
+				throw std::runtime_error(filename + " is not a result cache");
+			}
+			hasHeader = true;
+		}
+
+		while (std::getline(is, line))
+		{
+			std::istringstream ls(line);
+			std::string solver;
+			std::string moduleHash;
+			std::string graphHash;
+			Entry entry;
+			ls >> solver >> moduleHash >> graphHash >> entry.moveCount >> entry.solveSeconds;
+
+			// A line cut short by a crash is dropped, and solved again.
+			if (ls)
+			{
+				m_entries[solver + ' ' + moduleHash + ' ' + graphHash] = entry;
+			}
+		}
+	}
+
+	m_os.open(filename, std::ios::app);
+	if (!m_os)
+	{
+		throw std::runtime_error("Failed to open " + filename);
+	}
+
+	m_os << std::setprecision(9);
+	if (!hasHeader)
+	{
+		m_os << ResultCacheHeader << '\n';
+		m_os.flush();
+	}
+}
+
+bool ResultCache::find(const std::string& solver, uint64_t moduleHash, const GraphHash& graphHash, Entry& outEntry) const
+{
+	const auto it = m_entries.find(makeKey(solver, moduleHash, graphHash));
+	if (it == m_entries.cend())
+	{
+		return false;
+	}
+
+	outEntry = it->second;
+	return true;
+}
+
+void ResultCache::insert(const std::string& solver, uint64_t moduleHash, const GraphHash& graphHash, const Entry& entry)
+{
+	const std::string key = makeKey(solver, moduleHash, graphHash);
+	if (!m_entries.emplace(key, entry).second)
+	{
+		return;
+	}
+
+	m_os << key << ' ' << entry.moveCount << ' ' << entry.solveSeconds << '\n';
+	m_os.flush();
+}
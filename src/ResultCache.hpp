@@ -0,0 +1,44 @@
+#pragma once
+
+#include "GraphHash.hpp"
+
+#include <fstream>
+#include <string>
+#include <unordered_map>
+
+// Results of earlier solves, kept on disk by --cache, so that a graph seen before costs a
+// lookup instead of a solve. Results are keyed by the solver, a hash of the module it was
+// loaded from, so that rebuilding a solver invalidates its results, and the hash of the
+// graph. Every new result is appended and flushed right away, like a ResultStream.
+//
+// The file has a header line and then a line per result:
+//   <solver> <module hash> <graph hash> <moves> <seconds>
+class ResultCache final
+{
+public:
+	struct Entry
+	{
+		size_t moveCount;
+		double solveSeconds;
+	};
+
+private:
+	std::unordered_map<std::string, Entry> m_entries;
+	std::ofstream m_os;
+
+	static std::string makeKey(const std::string& solver, uint64_t moduleHash, const GraphHash& graphHash);
+
+public:
+	// Loads the results in the file, creating it if it doesn't exist. Throws if the file is
+	// malformed or can't be written.
+	explicit ResultCache(const std::string& filename);
+	ResultCache(const ResultCache&) = delete;
+
+	bool find(const std::string& solver, uint64_t moduleHash, const GraphHash& graphHash, Entry& outEntry) const;
+	void insert(const std::string& solver, uint64_t moduleHash, const GraphHash& graphHash, const Entry& entry);
+
+	__forceinline size_t size() const
+	{
+		return m_entries.size();
+	}
+};
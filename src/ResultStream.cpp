@@ -0,0 +1,98 @@
+#include "ResultStream.hpp"
+
+#include <experimental/filesystem>
+#include <iomanip>
+#include <stdexcept>
+#include <cmath>
+
+ResultStream::ResultStream(const std::string& filename, Format format)
+	: m_format(format)
+{
+	std::error_code ec;
+	const bool isEmpty = !std::experimental::filesystem::exists(filename, ec) || std::experimental::filesystem::file_size(filename, ec) == 0;
+
+	m_os.open(filename, std::ios::app);
+	if (!m_os)
+	{
+		throw std::runtime_error("Failed to open " + filename);
+	}
+
+	m_os << std::setprecision(9);
+
+	if (isEmpty && m_format == Csv)
+	{
+		m_os << "record;generator;size;iteration;moves;seconds;movesCi;secondsCi\n";
+		m_os.flush();
+	}
+}
+
+ResultStream::Format ResultStream::formatFromFilename(const std::string& filename)
+{
+	const auto extension = std::experimental::filesystem::path(filename).extension();
+	if (extension == ".jsonl" || extension == ".json")
+	{
+		return JsonLines;
+	}
+	return Csv;
+}
+
+void ResultStream::writeRecord(const char* record, const std::string& generator, size_t graphSize, size_t iteration, double moves, double seconds, const double* confidenceHalfWidths)
+{
+	if (m_format == Csv)
+	{
+		m_os << record << ';' << generator << ';' << graphSize << ';' << iteration << ';' << moves << ';' << seconds << ';';
+		if (confidenceHalfWidths)
+		{
+			m_os << confidenceHalfWidths[0] << ';' << confidenceHalfWidths[1];
+		}
+		else
+		{
+			m_os << ';';
+		}
+		m_os << '\n';
+	}
+	else
+	{
+		m_os << "{\"record\":\"" << record
+			<< "\",\"generator\":\"" << generator
+			<< "\",\"size\":" << graphSize
+			<< ",\"iteration\":" << iteration
+			<< ",\"moves\":" << moves
+			<< ",\"seconds\":" << seconds;
+		if (confidenceHalfWidths)
+		{
+			// A cell with a single iteration has no confidence interval, and JSON has no infinity.
+			const char* names[] = { ",\"movesCi\":", ",\"secondsCi\":" };
+			for (size_t it = 0; it < 2; ++it)
+			{
+				m_os << names[it];
+				if (std::isfinite(confidenceHalfWidths[it]))
+				{
+					m_os << confidenceHalfWidths[it];
+				}
+				else
+				{
+					m_os << "null";
+				}
+			}
+		}
+		m_os << "}\n";
+	}
+	m_os.flush();
+}
+
+void ResultStream::writeTrial(const std::string& generator, size_t graphSize, size_t iteration, size_t moveCount, double seconds)
+{
+	writeRecord("trial", generator, graphSize, iteration, (double)moveCount, seconds, nullptr);
+}
+
+void ResultStream::writeCachedTrial(const std::string& generator, size_t graphSize, size_t iteration, size_t moveCount, double seconds)
+{
+	writeRecord("cached", generator, graphSize, iteration, (double)moveCount, seconds, nullptr);
+}
+
+void ResultStream::writeCell(const std::string& generator, size_t graphSize, size_t iterations, double averageMoves, double averageSeconds, double movesHalfWidth, double secondsHalfWidth)
+{
+	const double confidenceHalfWidths[] = { movesHalfWidth, secondsHalfWidth };
+	writeRecord("cell", generator, graphSize, iterations, averageMoves, averageSeconds, confidenceHalfWidths);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <fstream>
+
+// Append-only stream of benchmark results. Every record is flushed as soon as it is
+// written, so a crashed or interrupted sweep keeps everything it finished.
+//
+// CSV files get one row per record with the columns
+//   record;generator;size;iteration;moves;seconds;movesCi;secondsCi
+// where "trial" records hold a single solve, and "cell" records hold the number of
+// iterations in the iteration column, the averages in the moves and seconds columns and
+// the half-widths of their 95% confidence intervals in the last two columns. Trial
+// records leave the last two columns empty. "cached" records are trials taken from the
+// result cache, with the seconds of the run that solved them. JSON Lines files get one
+// object per record with the same fields.
+class ResultStream final
+{
+public:
+	enum Format
+	{
+		Csv,
+		JsonLines,
+	};
+
+private:
+	std::ofstream m_os;
+	Format m_format;
+
+	void writeRecord(const char* record, const std::string& generator, size_t graphSize, size_t iteration, double moves, double seconds, const double* confidenceHalfWidths);
+
+public:
+	ResultStream(const std::string& filename, Format format);
+	ResultStream(const ResultStream&) = delete;
+
+	// Picks JSON Lines for .jsonl and .json files and CSV otherwise.
+	static Format formatFromFilename(const std::string& filename);
+
+	void writeTrial(const std::string& generator, size_t graphSize, size_t iteration, size_t moveCount, double seconds);
+	void writeCachedTrial(const std::string& generator, size_t graphSize, size_t iteration, size_t moveCount, double seconds);
+	void writeCell(const std::string& generator, size_t graphSize, size_t iterations, double averageMoves, double averageSeconds, double movesHalfWidth, double secondsHalfWidth);
+};
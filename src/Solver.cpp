@@ -1,11 +1,13 @@
 #include "Solver.hpp"
+#include "TimelineRecorder.hpp"
 
 GraphSolver::GraphSolver(const std::string& dllName)
-	: m_dll(dllName)
+	: m_dll(std::make_unique<DllHandle>(dllName))
+	, m_modulePath(dllName)
 {
-	m_fnGetName = m_dll.getProcAddress<FnGetName>("SOLVER_getName");
-	m_fnGetDescription = m_dll.getProcAddress<FnGetDescription>("SOLVER_getDescription");
-	m_fnSolve = m_dll.getProcAddress<FnSolve>("SOLVER_solve");
+	m_fnGetName = m_dll->getProcAddress<FnGetName>("SOLVER_getName");
+	m_fnGetDescription = m_dll->getProcAddress<FnGetDescription>("SOLVER_getDescription");
+	m_fnSolve = m_dll->getProcAddress<FnSolve>("SOLVER_solve");
 
 	if (m_fnGetName == nullptr)
 	{
@@ -23,6 +25,15 @@ GraphSolver::GraphSolver(const std::string& dllName)
 	}
 }
 
+#if DOLLARGAME_MONOLITHIC
+GraphSolver::GraphSolver(const StaticSolver& solver)
+	: m_fnGetName(solver.getName)
+	, m_fnGetDescription(solver.getDescription)
+	, m_fnSolve(solver.solve)
+{
+}
+#endif
+
 std::string GraphSolver::getName() const
 {
 	assert(m_fnGetName);
@@ -39,16 +50,21 @@ void GraphSolver::solve(SolverContext& ctx) const
 {
 	assert(m_fnSolve);
 
-	const auto isEmpty = [] (const auto& v) { return v.empty(); };
-	if (std::any_of(ctx.graph().connections().cbegin(), ctx.graph().connections().cend(), isEmpty))
 	{
-		throw std::invalid_argument("Graph contains dangling nodes");
-	}
+		TIMELINE_SCOPE("validate");
 
-	if (!ctx.isSolvable())
-	{
-		throw std::invalid_argument("Graph is unsolvable");
+		// Both checks are answered from state cached when the graph was initialized.
+		if (ctx.graph().hasDanglingNodes())
+		{
+			throw std::invalid_argument("Graph contains dangling nodes");
+		}
+
+		if (!ctx.isSolvable())
+		{
+			throw std::invalid_argument("Graph is unsolvable");
+		}
 	}
 
+	TIMELINE_SCOPE("solve");
 	(*m_fnSolve)(ctx);
 }
@@ -10,7 +10,9 @@ private:
 	typedef const char* (FnGetDescription)();
 	typedef void (FnSolve)(SolverContext&);
 
-	DllHandle m_dll;
+	// Null for solvers compiled into the executable.
+	std::unique_ptr<DllHandle> m_dll;
+	std::string m_modulePath;
 
 	FnGetName* m_fnGetName;
 	FnGetDescription* m_fnGetDescription;
@@ -18,8 +20,18 @@ private:
 
 public:
 	GraphSolver(const std::string& dllName);
+#if DOLLARGAME_MONOLITHIC
+	GraphSolver(const StaticSolver& solver);
+#endif
 
 	std::string getName() const;
 	std::string getDescription() const;
+
+	// Where the solver was loaded from. Empty for solvers compiled into the executable.
+	const std::string& getModulePath() const
+	{
+		return m_modulePath;
+	}
+
 	void solve(SolverContext& ctx) const;
 };
\ No newline at end of file
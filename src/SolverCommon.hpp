@@ -1,6 +1,10 @@
 #pragma once
 
 #include "Graph.hpp"
+#include "MoveTrace.hpp"
+#include "Timeline.hpp"
+
+#include <atomic>
 
 #if defined(_MSC_VER)
 #define DLLEXPORT __declspec(dllexport)
@@ -8,10 +12,53 @@
 #define DLLEXPORT __attribute__((visibility("default")))
 #endif
 
+#if DOLLARGAME_MONOLITHIC
+
+// The monolithic build compiles every solver into the executable. The entry points get
+// internal linkage instead of being exported, and SOLVER_FUNC registers them in a static
+// list that replaces the plugin discovery. SOLVER_NAME and SOLVER_DESCRIPTION have to
+// come before SOLVER_FUNC.
+class SolverContext;
+
+struct StaticSolver
+{
+	const char* (*getName)();
+	const char* (*getDescription)();
+	void (*solve)(SolverContext&);
+};
+
+inline std::vector<StaticSolver>& staticSolvers()
+{
+	static std::vector<StaticSolver> solvers;
+	return solvers;
+}
+
+struct StaticSolverRegistrar
+{
+	StaticSolverRegistrar(const StaticSolver& solver)
+	{
+		staticSolvers().push_back(solver);
+	}
+};
+
+#define SOLVER_NAME(Name) static const char* SOLVER_getName() { return Name; }
+#define SOLVER_DESCRIPTION(Description) static const char* SOLVER_getDescription() { return Description; }
+#define SOLVER_FUNC \
+	static void SOLVER_solve(SolverContext&); \
+	static const StaticSolverRegistrar solverRegistrar({ &SOLVER_getName, &SOLVER_getDescription, &SOLVER_solve }); \
+	static void SOLVER_solve
+
+#else
+
 #define SOLVER_NAME(Name) extern "C" DLLEXPORT const char* SOLVER_getName() { return Name; }
 #define SOLVER_DESCRIPTION(Description) extern "C" DLLEXPORT const char* SOLVER_getDescription() { return Description; }
 #define SOLVER_FUNC extern "C" DLLEXPORT void SOLVER_solve
 
+#endif
+
+// Records the rest of the enclosing scope as a span in the timeline trace (--trace).
+#define SOLVER_TRACE_SCOPE(ctx, Name) TimelineScope TIMELINE_CONCAT(solverTraceScope, __LINE__)((ctx).timeline(), TimelineCategory::Solver, Name)
+
 struct Move
 {
 	enum Type
@@ -33,23 +80,64 @@ struct Move
 class SolverContext final
 {
 private:
-	bool m_shouldStop;
+	// Set by the harness watchdog from another thread, and polled by multithreaded solvers.
+	std::atomic<bool> m_shouldStop;
 	Graph m_graph;
-	std::vector<Move>& m_moves;
+	HugePageVector<Move> m_moves;
+	size_t m_moveCount;
 	size_t m_moveLimit;
+	MoveTraceWriter* m_trace;
+	TimelineSink* m_timeline;
+	ThreadPool* m_threadPool;
+
+	__forceinline void recordMove(const Move& move)
+	{
+		// When tracing, the moves go to disk instead of the move list.
+		if (m_trace)
+		{
+			m_trace->append(encodeTraceMove(move.type, move.node));
+		}
+		else
+		{
+			m_moves.push_back(move);
+		}
+		++m_moveCount;
+	}
 
 public:
-	SolverContext(const Graph& graph, std::vector<Move>& outMoves, size_t moveLimit)
-		: m_graph(graph)
-		, m_moves(outMoves)
-		, m_shouldStop(false)
-		, m_moveLimit(moveLimit)
+	SolverContext()
+		: m_shouldStop(false)
+		, m_moveCount(0)
+		, m_moveLimit(0)
+		, m_trace(nullptr)
+		, m_timeline(nullptr)
+		, m_threadPool(nullptr)
 	{
-		m_moves.clear();
 	}
 
 	SolverContext(const SolverContext&) = delete;
 
+	// Prepares the context for the next solve. The graph and the move list keep their
+	// buffers, so a solve on a graph no larger than earlier ones doesn't allocate.
+	void reset(const Graph& graph, size_t moveLimit, MoveTraceWriter* trace = nullptr, TimelineSink* timeline = nullptr, ThreadPool* threadPool = nullptr)
+	{
+		m_shouldStop.store(false, std::memory_order_relaxed);
+		m_graph = graph;
+		m_moves.clear();
+		m_moveCount = 0;
+		m_moveLimit = moveLimit;
+		m_trace = trace;
+		m_timeline = timeline;
+		m_threadPool = threadPool;
+	}
+
+	// Frees the buffers that reset keeps, so that the next solve allocates all it needs.
+	void releaseBuffers()
+	{
+		m_graph = Graph();
+		HugePageVector<Move>().swap(m_moves);
+	}
+
 	__forceinline const Graph& graph() const
 	{
 		return m_graph;
@@ -60,11 +148,61 @@ public:
 		return m_graph.isSolvable();
 	}
 
+	__forceinline size_t moveCount() const
+	{
+		return m_moveCount;
+	}
+
+	// Empty when the moves are streamed to a trace file.
+	__forceinline const HugePageVector<Move>& moves() const
+	{
+		return m_moves;
+	}
+
+	// The nodes currently in debt, in no particular order. Lets debt-driven solvers work in
+	// time proportional to the number of debtors rather than the graph size. The range is
+	// invalidated by the next move.
+	__forceinline Range<const NodeHandle> debtors() const
+	{
+		const auto& debtors = m_graph.debtors();
+		return Range<const NodeHandle>(debtors.data(), debtors.size());
+	}
+
+	// 64-bit hash of the current node values, for cycle detection and transposition tables.
+	// The first call costs O(V + E), every move after that one addition.
+	__forceinline uint64_t stateHash()
+	{
+		if (!m_graph.hasStateHash())
+		{
+			m_graph.enableStateHash();
+		}
+		return m_graph.stateHash();
+	}
+
+	// The solve is cancelled once it registers more moves than this.
+	__forceinline size_t moveLimit() const
+	{
+		return m_moveLimit;
+	}
+
+	// Threads for solvers that work in parallel, also used by registerMoves. Only the solver
+	// thread may run tasks on it. May be null.
+	__forceinline ThreadPool* threadPool() const
+	{
+		return m_threadPool;
+	}
+
+	// Null unless timeline tracing is enabled. Use SOLVER_TRACE_SCOPE rather than this directly.
+	__forceinline TimelineSink* timeline() const
+	{
+		return m_timeline;
+	}
+
 	template<Move::Type type>
 	void registerMove(const NodeHandle& handle)
 	{
 		Move move(type, handle);
-		m_moves.push_back(move);
+		recordMove(move);
 		if constexpr (type == Move::Take)
 		{
 			m_graph.take(move.node);
@@ -75,9 +213,30 @@ public:
 		}
 	}
 
+	// Registers a move on every node at once. The nodes must be distinct and pairwise
+	// non-adjacent. The moves are recorded in the given order, which is a valid order as
+	// moves commute, and applied to the graph on the thread pool.
+	template<Move::Type type>
+	void registerMoves(Range<const NodeHandle> nodes)
+	{
+		for (const NodeHandle node : nodes)
+		{
+			recordMove(Move(type, node));
+		}
+
+		if constexpr (type == Move::Take)
+		{
+			m_graph.takeAll(nodes, m_threadPool);
+		}
+		else if constexpr (type == Move::Give)
+		{
+			m_graph.giveAll(nodes, m_threadPool);
+		}
+	}
+
 	void registerMove(const Move& move)
 	{
-		m_moves.push_back(move);
+		recordMove(move);
 		if (move.type == Move::Take)
 		{
 			m_graph.take(move.node);
@@ -91,21 +250,21 @@ public:
 	bool isSolved()
 	{
 		// Cancel the solve if the move limit has been reached.
-		if (m_moves.size() > m_moveLimit)
+		if (m_moveCount > m_moveLimit)
 		{
-			m_shouldStop = true;
+			m_shouldStop.store(true, std::memory_order_relaxed);
 		}
 
-		return m_shouldStop || m_graph.isSolved();
+		return m_shouldStop.load(std::memory_order_relaxed) || m_graph.isSolved();
 	}
 
 	__forceinline void stop()
 	{
-		m_shouldStop = true;
+		m_shouldStop.store(true, std::memory_order_relaxed);
 	}
 
 	__forceinline bool wasStopped() const
 	{
-		return m_shouldStop;
+		return m_shouldStop.load(std::memory_order_relaxed);
 	}
 };
\ No newline at end of file
@@ -0,0 +1,184 @@
+#include "Statistics.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <limits>
+
+double mean(const std::vector<double>& samples)
+{
+	if (samples.empty())
+	{
+		return 0.0;
+	}
+	return std::accumulate(samples.cbegin(), samples.cend(), 0.0) / (double)samples.size();
+}
+
+double variance(const std::vector<double>& samples)
+{
+	if (samples.size() < 2)
+	{
+		return 0.0;
+	}
+
+	const double m = mean(samples);
+	double sum = 0.0;
+	for (double sample : samples)
+	{
+		sum += (sample - m) * (sample - m);
+	}
+	return sum / (double)(samples.size() - 1);
+}
+
+double median(std::vector<double> samples)
+{
+	if (samples.empty())
+	{
+		return 0.0;
+	}
+
+	const size_t mid = samples.size() / 2;
+	std::nth_element(samples.begin(), samples.begin() + mid, samples.end());
+	if (samples.size() % 2 == 1)
+	{
+		return samples[mid];
+	}
+
+	const double upper = samples[mid];
+	const double lower = *std::max_element(samples.begin(), samples.begin() + mid);
+	return (lower + upper) / 2.0;
+}
+
+double normalCdf(double x)
+{
+	return 0.5 * std::erfc(-x / std::sqrt(2.0));
+}
+
+double normalQuantile(double p)
+{
+	// Acklam's rational approximation, relative error below 1.2e-9.
+	static const double a[] = { -3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02, 1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00 };
+	static const double b[] = { -5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02, 6.680131188771972e+01, -1.328068155288572e+01 };
+	static const double c[] = { -7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00, -2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00 };
+	static const double d[] = { 7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00, 3.754408661907416e+00 };
+	const double pLow = 0.02425;
+
+	if (p <= 0.0)
+	{
+		return -std::numeric_limits<double>::infinity();
+	}
+	else if (p >= 1.0)
+	{
+		return std::numeric_limits<double>::infinity();
+	}
+	else if (p < pLow || p > 1.0 - pLow)
+	{
+		const double q = std::sqrt(-2.0 * std::log(std::min(p, 1.0 - p)));
+		const double x = (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+			((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1.0);
+		return p < pLow ? x : -x;
+	}
+
+	const double q = p - 0.5;
+	const double r = q * q;
+	return (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q /
+		(((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1.0);
+}
+
+double studentTQuantile(double p, size_t degreesOfFreedom)
+{
+	const double pi = 3.14159265358979323846;
+
+	if (degreesOfFreedom == 0)
+	{
+		return std::numeric_limits<double>::quiet_NaN();
+	}
+	else if (degreesOfFreedom == 1)
+	{
+		return std::tan(pi * (p - 0.5));
+	}
+	else if (degreesOfFreedom == 2)
+	{
+		return (2.0 * p - 1.0) / std::sqrt(2.0 * p * (1.0 - p));
+	}
+
+	const double z = normalQuantile(p);
+	const double z2 = z * z;
+	const double v = (double)degreesOfFreedom;
+	const double g1 = (z2 + 1.0) * z / 4.0;
+	const double g2 = ((5.0 * z2 + 16.0) * z2 + 3.0) * z / 96.0;
+	const double g3 = (((3.0 * z2 + 19.0) * z2 + 17.0) * z2 - 15.0) * z / 384.0;
+	const double g4 = ((((79.0 * z2 + 776.0) * z2 + 1482.0) * z2 - 1920.0) * z2 - 945.0) * z / 92160.0;
+	return z + g1 / v + g2 / (v * v) + g3 / (v * v * v) + g4 / (v * v * v * v);
+}
+
+double confidenceHalfWidth(double variance, size_t sampleCount, double confidence)
+{
+	if (sampleCount < 2)
+	{
+		return std::numeric_limits<double>::infinity();
+	}
+
+	const double t = studentTQuantile(0.5 + confidence / 2.0, sampleCount - 1);
+	return t * std::sqrt(variance / (double)sampleCount);
+}
+
+double mannWhitneyPValue(const std::vector<double>& a, const std::vector<double>& b)
+{
+	const size_t n1 = a.size();
+	const size_t n2 = b.size();
+	if (n1 == 0 || n2 == 0)
+	{
+		return 1.0;
+	}
+
+	// Rank the pooled samples, giving tied samples their average rank.
+	std::vector<std::pair<double, size_t>> pooled;
+	pooled.reserve(n1 + n2);
+	for (double sample : a)
+	{
+		pooled.emplace_back(sample, 0);
+	}
+	for (double sample : b)
+	{
+		pooled.emplace_back(sample, 1);
+	}
+	std::sort(pooled.begin(), pooled.end());
+
+	const double n = (double)(n1 + n2);
+	double rankSumA = 0.0;
+	double tieCorrection = 0.0;
+	for (size_t first = 0; first < pooled.size();)
+	{
+		size_t last = first;
+		while (last < pooled.size() && pooled[last].first == pooled[first].first)
+		{
+			++last;
+		}
+
+		const double tieCount = (double)(last - first);
+		const double averageRank = (double)(first + last + 1) / 2.0;
+		for (size_t it = first; it < last; ++it)
+		{
+			if (pooled[it].second == 0)
+			{
+				rankSumA += averageRank;
+			}
+		}
+		tieCorrection += tieCount * tieCount * tieCount - tieCount;
+
+		first = last;
+	}
+
+	const double u = rankSumA - (double)n1 * (double)(n1 + 1) / 2.0;
+	const double meanU = (double)n1 * (double)n2 / 2.0;
+	const double varianceU = (double)n1 * (double)n2 / 12.0 * ((n + 1.0) - tieCorrection / (n * (n - 1.0)));
+	if (varianceU <= 0.0)
+	{
+		// All samples are equal.
+		return 1.0;
+	}
+
+	const double z = (std::abs(u - meanU) - 0.5) / std::sqrt(varianceU);
+	return std::min(1.0, 2.0 * (1.0 - normalCdf(std::max(0.0, z))));
+}
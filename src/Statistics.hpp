@@ -0,0 +1,30 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+double mean(const std::vector<double>& samples);
+
+// Unbiased sample variance.
+double variance(const std::vector<double>& samples);
+
+double median(std::vector<double> samples);
+
+// Cumulative distribution function of the standard normal distribution.
+double normalCdf(double x);
+
+// Quantile function of the standard normal distribution.
+double normalQuantile(double p);
+
+// Quantile function of Student's t distribution. Exact for one and two degrees of freedom,
+// and a Cornish-Fisher expansion of the normal quantile otherwise.
+double studentTQuantile(double p, size_t degreesOfFreedom);
+
+// Half-width of the two-sided confidence interval of a mean, given the unbiased sample
+// variance. Infinite with fewer than two samples.
+double confidenceHalfWidth(double variance, size_t sampleCount, double confidence = 0.95);
+
+// Two-sided p-value of the Mann-Whitney U test, using the normal approximation with tie
+// correction. Makes no assumption about the shape of the distributions, which suits
+// timings with their long right tails.
+double mannWhitneyPValue(const std::vector<double>& a, const std::vector<double>& b);
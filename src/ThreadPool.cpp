@@ -0,0 +1,108 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(size_t threadCount, std::function<void()> initWorker)
+	: m_initWorker(std::move(initWorker))
+	, m_generation(0)
+	, m_busyWorkers(0)
+	, m_exiting(false)
+	, m_task(nullptr)
+	, m_taskContext(nullptr)
+	, m_taskCount(0)
+	, m_nextTask(0)
+{
+	// hardware_concurrency may return 0 if it can't tell.
+	threadCount = std::max<size_t>(threadCount, 1);
+	for (size_t threadIt = 1; threadIt < threadCount; ++threadIt)
+	{
+		m_threads.emplace_back(&ThreadPool::workerThread, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_exiting = true;
+		m_wakeCondition.notify_all();
+	}
+
+	for (auto& thread : m_threads)
+	{
+		thread.join();
+	}
+}
+
+void ThreadPool::runTasks()
+{
+	while (true)
+	{
+		const size_t taskIndex = m_nextTask.fetch_add(1, std::memory_order_relaxed);
+		if (taskIndex >= m_taskCount)
+		{
+			return;
+		}
+		m_task(m_taskContext, taskIndex);
+	}
+}
+
+void ThreadPool::workerThread()
+{
+	if (m_initWorker)
+	{
+		m_initWorker();
+	}
+
+	uint64_t generation = 0;
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true)
+	{
+		m_wakeCondition.wait(lock, [this, generation] { return m_generation != generation || m_exiting; });
+		if (m_exiting)
+		{
+			return;
+		}
+		generation = m_generation;
+
+		lock.unlock();
+		runTasks();
+		lock.lock();
+
+		if (--m_busyWorkers == 0)
+		{
+			m_doneCondition.notify_all();
+		}
+	}
+}
+
+void ThreadPool::run(size_t taskCount, void (*task)(void*, size_t), void* context)
+{
+	if (m_threads.empty() || taskCount <= 1)
+	{
+		for (size_t taskIndex = 0; taskIndex < taskCount; ++taskIndex)
+		{
+			task(context, taskIndex);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_task = task;
+		m_taskContext = context;
+		m_taskCount = taskCount;
+		m_nextTask.store(0, std::memory_order_relaxed);
+		m_busyWorkers = m_threads.size();
+		++m_generation;
+		m_wakeCondition.notify_all();
+	}
+
+	runTasks();
+
+	// Every worker has to have seen this generation before the next run can reset the
+	// task counter.
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_doneCondition.wait(lock, [this] { return m_busyWorkers == 0; });
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed set of worker threads for fork-join parallelism. run() hands out task indices to the
+// workers and to the calling thread, and returns once every task has finished. Only one
+// thread may call run() at a time, and tasks must not throw.
+class ThreadPool final
+{
+private:
+	std::vector<std::thread> m_threads;
+	std::function<void()> m_initWorker;
+
+	std::mutex m_mutex;
+	std::condition_variable m_wakeCondition;
+	std::condition_variable m_doneCondition;
+	uint64_t m_generation;
+	size_t m_busyWorkers;
+	bool m_exiting;
+
+	void (*m_task)(void*, size_t);
+	void* m_taskContext;
+	size_t m_taskCount;
+	std::atomic<size_t> m_nextTask;
+
+	void workerThread();
+	void runTasks();
+
+public:
+	// The calling thread counts as one of the threads, so a pool of one runs tasks inline.
+	// Every worker calls initWorker, if given, when it starts.
+	explicit ThreadPool(size_t threadCount = std::thread::hardware_concurrency(), std::function<void()> initWorker = nullptr);
+	ThreadPool(const ThreadPool&) = delete;
+	~ThreadPool();
+
+	// Number of threads that run tasks, including the caller of run().
+	__forceinline size_t size() const
+	{
+		return m_threads.size() + 1;
+	}
+
+	void run(size_t taskCount, void (*task)(void*, size_t), void* context);
+
+	// Calls fn(taskIndex) for every index below taskCount.
+	template<typename Fn>
+	void run(size_t taskCount, Fn&& fn)
+	{
+		typedef std::remove_reference_t<Fn> Function;
+		run(taskCount, [] (void* context, size_t taskIndex) {
+			(*static_cast<Function*>(context))(taskIndex);
+		}, (void*)&fn);
+	}
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <cinttypes>
+
+enum class TimelineCategory : uint8_t
+{
+	Harness,
+	Solver,
+};
+
+// Receives timed spans for the timeline trace. The harness implements it and hands it to
+// solvers through their context, so spans recorded inside a plugin end up in the same trace.
+class TimelineSink
+{
+public:
+	virtual void recordSpan(TimelineCategory category, const char* name, uint64_t beginNs, uint64_t endNs) = 0;
+
+protected:
+	~TimelineSink() = default;
+};
+
+inline uint64_t timelineNow()
+{
+	const auto now = std::chrono::steady_clock::now().time_since_epoch();
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+}
+
+// Records the lifetime of the scope as a span. Does nothing but a null check when there
+// is no sink, i.e. when timeline tracing is disabled.
+class TimelineScope final
+{
+private:
+	TimelineSink* m_sink;
+	TimelineCategory m_category;
+	const char* m_name;
+	uint64_t m_begin;
+
+public:
+	TimelineScope(TimelineSink* sink, TimelineCategory category, const char* name)
+		: m_sink(sink)
+		, m_category(category)
+		, m_name(name)
+		, m_begin(sink ? timelineNow() : 0)
+	{
+	}
+
+	TimelineScope(const TimelineScope&) = delete;
+
+	~TimelineScope()
+	{
+		if (m_sink)
+		{
+			m_sink->recordSpan(m_category, m_name, m_begin, timelineNow());
+		}
+	}
+};
+
+#define TIMELINE_CONCAT_INNER(a, b) a##b
+#define TIMELINE_CONCAT(a, b) TIMELINE_CONCAT_INNER(a, b)
@@ -0,0 +1,161 @@
+#include "TimelineRecorder.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+
+TimelineRecorder* TimelineRecorder::s_active = nullptr;
+
+namespace
+{
+	struct ThreadState
+	{
+		TimelineRecorder::ThreadBuffer* buffer = nullptr;
+		uint32_t threadId = 0;
+
+		~ThreadState()
+		{
+			if (buffer)
+			{
+				TimelineRecorder::active()->releaseBuffer(buffer);
+			}
+		}
+	};
+
+	thread_local ThreadState t_threadState;
+}
+
+static void writeJsonString(std::ostream& os, const char* str)
+{
+	os << '"';
+	for (const char* it = str; *it; ++it)
+	{
+		if (*it == '"' || *it == '\\')
+		{
+			os << '\\';
+		}
+		os << *it;
+	}
+	os << '"';
+}
+
+TimelineRecorder::TimelineRecorder()
+	: m_nextThreadId(1)
+	, m_startTime(timelineNow())
+{
+}
+
+void TimelineRecorder::enable()
+{
+	if (s_active == nullptr)
+	{
+		// Never destroyed, since threads may still return their buffers during shutdown.
+		s_active = new TimelineRecorder();
+	}
+}
+
+TimelineRecorder::ThreadBuffer* TimelineRecorder::acquireBuffer(uint32_t& outThreadId)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	outThreadId = m_nextThreadId++;
+
+	if (!m_freeBuffers.empty())
+	{
+		ThreadBuffer* buffer = m_freeBuffers.back();
+		m_freeBuffers.pop_back();
+		return buffer;
+	}
+
+	m_buffers.push_back(std::make_unique<ThreadBuffer>());
+	m_buffers.back()->events.resize(EventsPerThread);
+	return m_buffers.back().get();
+}
+
+void TimelineRecorder::releaseBuffer(ThreadBuffer* buffer)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_freeBuffers.push_back(buffer);
+}
+
+void TimelineRecorder::recordSpan(TimelineCategory category, const char* name, uint64_t beginNs, uint64_t endNs)
+{
+	ThreadState& state = t_threadState;
+	if (state.buffer == nullptr)
+	{
+		state.buffer = acquireBuffer(state.threadId);
+	}
+
+	ThreadBuffer& buffer = *state.buffer;
+	Event& event = buffer.events[buffer.next % EventsPerThread];
+	++buffer.next;
+
+	// Names are copied since they may point into a plugin that is unloaded before the trace is written.
+	strncpy(event.name, name, MaxNameLength);
+	event.name[MaxNameLength] = '\0';
+	event.category = category;
+	event.threadId = state.threadId;
+	event.begin = beginNs;
+	event.end = endNs;
+}
+
+void TimelineRecorder::setThreadName(const std::string& name)
+{
+	ThreadState& state = t_threadState;
+	if (state.buffer == nullptr)
+	{
+		state.buffer = acquireBuffer(state.threadId);
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_threadNames.emplace_back(state.threadId, name);
+}
+
+void TimelineRecorder::write(const std::string& filename)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	std::vector<const Event*> events;
+	for (const auto& buffer : m_buffers)
+	{
+		const size_t count = std::min(buffer->next, EventsPerThread);
+		for (size_t eventIt = 0; eventIt < count; ++eventIt)
+		{
+			events.push_back(&buffer->events[eventIt]);
+		}
+	}
+
+	std::sort(events.begin(), events.end(), [] (const Event* lhs, const Event* rhs) {
+		return lhs->begin < rhs->begin;
+	});
+
+	std::ofstream os(filename);
+	os << std::fixed << std::setprecision(3);
+	os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+	bool first = true;
+	for (const auto& threadName : m_threadNames)
+	{
+		os << (first ? "" : ",\n");
+		os << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << threadName.first << ",\"args\":{\"name\":";
+		writeJsonString(os, threadName.second.c_str());
+		os << "}}";
+		first = false;
+	}
+
+	for (const Event* event : events)
+	{
+		const double ts = (double)(int64_t)(event->begin - m_startTime) / 1000.0;
+		const double dur = (double)(event->end - event->begin) / 1000.0;
+
+		os << (first ? "" : ",\n");
+		os << "{\"name\":";
+		writeJsonString(os, event->name);
+		os << ",\"cat\":\"" << (event->category == TimelineCategory::Solver ? "solver" : "harness") << "\"";
+		os << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << event->threadId << ",\"ts\":" << ts << ",\"dur\":" << dur << "}";
+		first = false;
+	}
+
+	os << "\n]}\n";
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "Timeline.hpp"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+
+// Collects timeline spans from all threads and writes them as a Chrome trace-event file,
+// which can be opened in chrome://tracing or Perfetto. Every thread records into its own
+// ring buffer, so the newest spans are kept if a thread records more than fits.
+class TimelineRecorder final : public TimelineSink
+{
+public:
+	static constexpr size_t MaxNameLength = 31;
+	static constexpr size_t EventsPerThread = 1 << 16;
+
+	struct Event
+	{
+		char name[MaxNameLength + 1];
+		TimelineCategory category;
+		uint32_t threadId;
+		uint64_t begin;
+		uint64_t end;
+	};
+
+	struct ThreadBuffer
+	{
+		std::vector<Event> events;
+		size_t next = 0;
+	};
+
+private:
+	static TimelineRecorder* s_active;
+
+	std::mutex m_mutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> m_buffers;
+	std::vector<ThreadBuffer*> m_freeBuffers;
+	std::vector<std::pair<uint32_t, std::string>> m_threadNames;
+	uint32_t m_nextThreadId;
+	uint64_t m_startTime;
+
+public:
+	TimelineRecorder();
+	TimelineRecorder(const TimelineRecorder&) = delete;
+
+	// The recorder that spans should go to, or null if timeline tracing is disabled.
+	__forceinline static TimelineRecorder* active()
+	{
+		return s_active;
+	}
+
+	static void enable();
+
+	void recordSpan(TimelineCategory category, const char* name, uint64_t beginNs, uint64_t endNs) override;
+
+	// Labels the calling thread in the trace.
+	void setThreadName(const std::string& name);
+
+	void write(const std::string& filename);
+
+	// Used by the per-thread state to get and return ring buffers. Buffers of finished
+	// threads are reused by new threads, which keeps short-lived solver threads cheap.
+	ThreadBuffer* acquireBuffer(uint32_t& outThreadId);
+	void releaseBuffer(ThreadBuffer* buffer);
+};
+
+#define TIMELINE_SCOPE(Name) TimelineScope TIMELINE_CONCAT(timelineScope, __LINE__)(TimelineRecorder::active(), TimelineCategory::Harness, Name)
@@ -5,22 +5,9 @@ GENERATOR_DESCRIPTION("Generates a circular graph.")
 
 GENERATOR_FUNC(GeneratorContext& ctx, const GeneratorParams& params)
 {
-	std::uniform_int_distribution<NodeValue> valueDist(params.minValue(), params.maxValue());
-	std::vector<NodeValue> values(params.size());
-	for (NodeHandle nodeIt = 0; nodeIt < params.size(); ++nodeIt)
-	{
-		values[nodeIt] = valueDist(ctx.random());
-	}
+	auto& values = ctx.values(params.size());
+	ctx.fillUniformValues(Range<NodeValue>(values.data(), values.size()), params.minValue(), params.maxValue());
 
-	std::set<Edge> edges;
-	for (NodeHandle nodeIt = 0; nodeIt < params.size() - 1; ++nodeIt)
-	{
-		const Edge edge(nodeIt, nodeIt + 1);
-		edges.insert(edge);
-	}
-
-	// Connect the last and the first node, closing the loop.
-	edges.insert(Edge((NodeHandle)params.size() - 1, 0));
-
-	ctx.graph().init(values, edges);
+	// The ring is implicit, so no adjacency is stored.
+	ctx.graph().init(values, ctx.topologies().ring(params.size()));
 }
\ No newline at end of file
@@ -5,19 +5,9 @@ GENERATOR_DESCRIPTION("Generates a graph where all nodes are connected to one co
 
 GENERATOR_FUNC(GeneratorContext& ctx, const GeneratorParams& params)
 {
-	std::uniform_int_distribution<NodeValue> valueDist(params.minValue(), params.maxValue());
-	std::vector<NodeValue> values(params.size());
-	for (NodeHandle nodeIt = 0; nodeIt < params.size(); ++nodeIt)
-	{
-		values[nodeIt] = valueDist(ctx.random());
-	}
+	auto& values = ctx.values(params.size());
+	ctx.fillUniformValues(Range<NodeValue>(values.data(), values.size()), params.minValue(), params.maxValue());
 
-	std::set<Edge> edges;
-	for (NodeHandle nodeIt = 1; nodeIt < params.size(); ++nodeIt)
-	{
-		const Edge edge(0, nodeIt);
-		edges.insert(edge);
-	}
-
-	ctx.graph().init(values, edges);
+	// Node 0 is the center. The star is implicit, so no adjacency is stored.
+	ctx.graph().init(values, ctx.topologies().star(params.size()));
 }
\ No newline at end of file
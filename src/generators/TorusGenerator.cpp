@@ -0,0 +1,24 @@
+#include "../GeneratorCommon.hpp"
+
+GENERATOR_NAME("Torus")
+GENERATOR_DESCRIPTION("Generates a square grid that wraps around at its edges, with the largest size not above the requested one, which must be at least 9.")
+
+#include <cmath>
+#include <stdexcept>
+
+GENERATOR_FUNC(GeneratorContext& ctx, const GeneratorParams& params)
+{
+	// Narrower grids would connect a node to the same neighbor twice.
+	if (params.size() < 9)
+	{
+		throw std::runtime_error("Torus: a torus needs at least 3x3 nodes. Use sizes of 9 or more.");
+	}
+
+	const size_t width = (size_t)std::sqrt((double)params.size());
+	const size_t height = params.size() / width;
+
+	auto& values = ctx.values(width * height);
+	ctx.fillUniformValues(Range<NodeValue>(values.data(), values.size()), params.minValue(), params.maxValue());
+
+	ctx.graph().init(values, ctx.topologies().torus(width, height));
+}
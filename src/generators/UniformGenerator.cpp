@@ -8,30 +8,50 @@ GENERATOR_DESCRIPTION("Simple generator.")
 
 GENERATOR_FUNC(GeneratorContext& ctx, const GeneratorParams& params)
 {
-	std::uniform_int_distribution<NodeValue> valueDist(params.minValue(), params.maxValue());
-	std::vector<NodeValue> values(params.size());
-	for (NodeHandle nodeIt = 0; nodeIt < params.size(); ++nodeIt)
-	{
-		values[nodeIt] = valueDist(ctx.random());
-	}
+	auto& values = ctx.values(params.size());
+	ctx.fillUniformValues(Range<NodeValue>(values.data(), values.size()), params.minValue(), params.maxValue());
 
+	// Two offsets to the other end of the edges of every node are drawn up front. An edge
+	// that is already there draws its replacement one at a time. The degrees follow them in
+	// the same buffer.
+	auto& handles = ctx.handles(params.size() * 3);
+	Range<NodeHandle> offsets(handles.data(), params.size() * 2);
+	Range<NodeHandle> degrees(handles.data() + params.size() * 2, params.size());
+	ctx.fillUniformHandles(offsets, 1, (NodeHandle)params.size() - 1);
+	std::fill(degrees.begin(), degrees.end(), 0);
 	std::uniform_int_distribution<NodeHandle> connDist(1, (NodeHandle)params.size() - 1);
 
-	std::set<Edge> edges;
+	auto& edgeSet = ctx.edgeSet(params.size() * 2);
+	auto& edges = ctx.edges();
 	for (NodeHandle nodeIt = 0; nodeIt < params.size(); ++nodeIt)
 	{
-		for (int i = 0; i < 2;)
+		for (int i = 0, drawIt = 0; i < 2;)
 		{
-			const NodeHandle other = (nodeIt + connDist(ctx.random())) % params.size();
+			const bool usePreDrawn = drawIt < 2;
+			if (!usePreDrawn && degrees[nodeIt] == params.size() - 1)
+			{
+				throw std::runtime_error("Uniform: node " + std::to_string(nodeIt) + " is already connected to all other nodes and can't get two new edges. Use larger graphs.");
+			}
+
+			const NodeHandle offset = usePreDrawn ? offsets[nodeIt * 2 + drawIt] : connDist(ctx.random());
+			drawIt += usePreDrawn;
+
+			const NodeHandle other = (nodeIt + offset) % params.size();
 			assert(nodeIt != other);
 
 			const Edge edge(nodeIt, other);
-			if (edges.insert(edge).second)
+			if (edgeSet.insert(edge))
 			{
+				edges.push_back(edge);
+				++degrees[nodeIt];
+				++degrees[other];
 				++i;
 			}
 		}
 	}
 
-	ctx.graph().init(values, edges);
+	// In std::set order, which the adjacency lists follow.
+	std::sort(edges.begin(), edges.end());
+
+	ctx.graph().init(values, ctx.topologies().build(params.size(), edges, ctx.threadPool()));
 }
\ No newline at end of file
@@ -0,0 +1,81 @@
+#include "../SolverCommon.hpp"
+#include "../ThreadPool.hpp"
+
+SOLVER_NAME("IndependentSet")
+SOLVER_DESCRIPTION("Takes from the neighbors of every debtor that is poorer than its neighbors in debt at once, on all cores.")
+
+// Debtors per task.
+static constexpr size_t TaskSize = 1024;
+
+template<typename Fn>
+static void forEachIndex(ThreadPool* threadPool, size_t count, Fn&& fn)
+{
+	const auto task = [count, &fn] (size_t taskIndex) {
+		const size_t end = std::min(count, (taskIndex + 1) * TaskSize);
+		for (size_t index = taskIndex * TaskSize; index < end; ++index)
+		{
+			fn(index);
+		}
+	};
+
+	const size_t taskCount = (count + TaskSize - 1) / TaskSize;
+	if (threadPool)
+	{
+		threadPool->run(taskCount, task);
+	}
+	else
+	{
+		for (size_t taskIndex = 0; taskIndex < taskCount; ++taskIndex)
+		{
+			task(taskIndex);
+		}
+	}
+}
+
+// Poorer by value, then by handle, as in TakePoorest.
+static inline bool isPoorer(const Graph& graph, NodeHandle a, NodeHandle b)
+{
+	const NodeValue valueA = graph.getNodeValue(a);
+	const NodeValue valueB = graph.getNodeValue(b);
+	return valueA < valueB || (valueA == valueB && a < b);
+}
+
+SOLVER_FUNC(SolverContext& ctx)
+{
+	const Graph& graph = ctx.graph();
+
+	std::vector<NodeHandle> debtors;
+	std::vector<uint8_t> isPicked;
+	std::vector<NodeHandle> picked;
+
+	while (!ctx.isSolved())
+	{
+		// Sorted, so that the moves are recorded in the same order on any number of threads.
+		const auto currentDebtors = ctx.debtors();
+		debtors.assign(currentDebtors.begin(), currentDebtors.end());
+		std::sort(debtors.begin(), debtors.end());
+
+		// A debtor is picked if no neighbor is a poorer debtor. That makes the picked debtors
+		// independent, and always includes the poorest one.
+		isPicked.resize(debtors.size());
+		forEachIndex(ctx.threadPool(), debtors.size(), [&graph, &debtors, &isPicked] (size_t index) {
+			const NodeHandle debtor = debtors[index];
+			bool isLocalMinimum = true;
+			graph.topology().forEachConnection(debtor, [&graph, debtor, &isLocalMinimum] (NodeHandle connection) {
+				isLocalMinimum &= graph.getNodeValue(connection) >= 0 || isPoorer(graph, debtor, connection);
+			});
+			isPicked[index] = isLocalMinimum;
+		});
+
+		picked.clear();
+		for (size_t index = 0; index < debtors.size(); ++index)
+		{
+			if (isPicked[index])
+			{
+				picked.push_back(debtors[index]);
+			}
+		}
+
+		ctx.registerMoves<Move::Take>(Range<const NodeHandle>(picked.data(), picked.size()));
+	}
+}
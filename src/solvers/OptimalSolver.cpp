@@ -0,0 +1,495 @@
+#include "../SolverCommon.hpp"
+#include "../ThreadPool.hpp"
+
+SOLVER_NAME("Optimal")
+SOLVER_DESCRIPTION("Finds a solution with the fewest possible moves using parallel IDA*. Only feasible on small graphs.")
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <deque>
+
+// Moves commute, so a state only depends on how often every node gave and took. The
+// search runs iterative deepening A* over states: every iteration is a depth-first search
+// that prunes states whose depth plus lower bound exceeds the threshold, and the next
+// threshold is the smallest bound that was exceeded. The first solution found is
+// therefore optimal.
+//
+// The lower bound is debt based. A give pays at most one dollar to each neighbor and a
+// take collects at most one dollar from each neighbor, so no move reduces the total debt
+// by more than the maximum degree.
+//
+// The many move orders that lead to the same state are cut off by a transposition table
+// that remembers the smallest depth every state was seen at in the current iteration. It
+// is keyed by the additive state hash of the graph (StateHashKeys), which every move
+// updates with a single addition.
+
+namespace
+{
+	// How often a worker checks whether the search was cancelled or solved elsewhere.
+	constexpr size_t PollInterval = 4096;
+
+	// Only subtrees with at least this much depth left are split up for idle workers.
+	constexpr uint32_t MinSplitBudget = 3;
+
+	// How long an idle worker sleeps before it checks whether the search was cancelled.
+	constexpr std::chrono::milliseconds IdleWaitTime(10);
+
+	constexpr uint32_t NoThreshold = std::numeric_limits<uint32_t>::max();
+
+	// Lockless hash table (Hyatt and Mann). The key is stored xor'ed with the data, so an
+	// entry torn by two concurrent writers fails the key check and reads as a miss.
+	class TranspositionTable final
+	{
+	private:
+		struct Entry
+		{
+			std::atomic<uint64_t> check;
+			std::atomic<uint64_t> data;
+		};
+
+		std::unique_ptr<Entry[]> m_entries;
+		size_t m_mask;
+
+	public:
+		TranspositionTable(size_t entryCountLog2)
+			: m_entries(new Entry[size_t(1) << entryCountLog2])
+			, m_mask((size_t(1) << entryCountLog2) - 1)
+		{
+			for (size_t entryIt = 0; entryIt <= m_mask; ++entryIt)
+			{
+				m_entries[entryIt].check.store(0, std::memory_order_relaxed);
+				m_entries[entryIt].data.store(0, std::memory_order_relaxed);
+			}
+		}
+
+		// Returns false if the state was already seen in this iteration at the same or a
+		// smaller depth. Otherwise records it and returns true.
+		bool visit(uint64_t hash, uint32_t iteration, uint32_t depth)
+		{
+			Entry& entry = m_entries[hash & m_mask];
+
+			const uint64_t data = entry.data.load(std::memory_order_relaxed);
+			const uint64_t check = entry.check.load(std::memory_order_relaxed);
+			if ((check ^ data) == hash && (uint32_t)(data >> 32) == iteration && (uint32_t)data <= depth)
+			{
+				return false;
+			}
+
+			const uint64_t newData = ((uint64_t)iteration << 32) | depth;
+			entry.data.store(newData, std::memory_order_relaxed);
+			entry.check.store(hash ^ newData, std::memory_order_relaxed);
+			return true;
+		}
+	};
+
+	// A subtree of the search, identified by the moves leading to it from the initial graph.
+	struct SearchTask
+	{
+		std::vector<Move> moves;
+	};
+
+	// Tasks owned by one worker. The owner works depth-first from the back, thieves take
+	// the shallowest and therefore largest subtrees from the front.
+	struct TaskQueue
+	{
+		std::mutex mutex;
+		std::deque<SearchTask> tasks;
+	};
+
+	class OptimalSearch final
+	{
+	private:
+		SolverContext& m_ctx;
+		const Graph& m_graph;
+
+		// Copied once, as reading the values of the graph may settle its lazy hubs.
+		std::vector<NodeValue> m_initialValues;
+
+		// Must be initialized before m_hashKeys, as it enables the state hash.
+		uint64_t m_initialHash;
+		const StateHashKeys& m_hashKeys;
+		int64_t m_initialDebt;
+		uint32_t m_maxDegree;
+
+		TranspositionTable m_transpositions;
+		std::vector<TaskQueue> m_queues;
+
+		uint32_t m_iteration;
+		uint32_t m_threshold;
+		std::atomic<uint32_t> m_nextThreshold;
+		std::atomic<size_t> m_pendingTasks;
+		std::atomic<size_t> m_idleWorkers;
+		std::atomic<bool> m_solved;
+
+		// Idle workers wait for the wake count to change, which it does when tasks are
+		// pushed, when the last task finishes and when a solution is found.
+		std::mutex m_idleMutex;
+		std::condition_variable m_idleCondition;
+		std::atomic<uint64_t> m_wakeCount;
+
+		std::mutex m_solutionMutex;
+		std::vector<Move> m_solution;
+
+		friend class SearchWorker;
+
+	public:
+		// One worker per thread of the solver's thread pool.
+		explicit OptimalSearch(SolverContext& ctx);
+
+		__forceinline uint32_t lowerBound(int64_t debt) const
+		{
+			return (uint32_t)((debt + m_maxDegree - 1) / m_maxDegree);
+		}
+
+		// Returns false if the search was cancelled or the move limit was exceeded.
+		bool run();
+
+		const std::vector<Move>& solution() const
+		{
+			return m_solution;
+		}
+
+	private:
+		bool runIteration();
+		void push(size_t queueIndex, SearchTask&& task);
+		bool tryPop(size_t queueIndex, SearchTask& outTask);
+		void wakeIdleWorkers();
+	};
+
+	class SearchWorker final
+	{
+	private:
+		OptimalSearch& m_search;
+		const size_t m_index;
+
+		std::vector<NodeValue> m_values;
+		std::vector<Move> m_path;
+		uint64_t m_hash;
+		int64_t m_debt;
+
+		uint32_t m_nextThreshold;
+		size_t m_nodeCount;
+		bool m_aborted;
+
+		__forceinline void apply(Move::Type type, NodeHandle node)
+		{
+			const NodeValue neighborDelta = type == Move::Give ? 1 : -1;
+
+			const size_t degree = m_search.m_graph.topology().forEachConnection(node, [this, neighborDelta] (NodeHandle connection) {
+				NodeValue& value = m_values[connection];
+				m_debt -= std::max(-value, 0);
+				value += neighborDelta;
+				m_debt += std::max(-value, 0);
+			});
+
+			NodeValue& value = m_values[node];
+			m_debt -= std::max(-value, 0);
+			value -= neighborDelta * (NodeValue)degree;
+			m_debt += std::max(-value, 0);
+
+			if (type == Move::Give)
+			{
+				m_hash += m_search.m_hashKeys.giveDelta(node);
+			}
+			else
+			{
+				m_hash -= m_search.m_hashKeys.giveDelta(node);
+			}
+		}
+
+		__forceinline void undo(Move::Type type, NodeHandle node)
+		{
+			apply(type == Move::Give ? Move::Take : Move::Give, node);
+		}
+
+		bool poll();
+		bool search();
+
+	public:
+		SearchWorker(OptimalSearch& search, size_t index);
+
+		void run();
+	};
+}
+
+OptimalSearch::OptimalSearch(SolverContext& ctx)
+	: m_ctx(ctx)
+	, m_graph(ctx.graph())
+	, m_initialValues(ctx.graph().values().cbegin(), ctx.graph().values().cend())
+	, m_initialHash(ctx.stateHash())
+	, m_hashKeys(ctx.graph().stateHashKeys())
+	, m_initialDebt(0)
+	, m_maxDegree(1)
+	, m_transpositions(20)
+	, m_queues(ctx.threadPool() ? ctx.threadPool()->size() : 1)
+	, m_iteration(0)
+	, m_threshold(0)
+	, m_nextThreshold(NoThreshold)
+	, m_pendingTasks(0)
+	, m_idleWorkers(0)
+	, m_solved(false)
+	, m_wakeCount(0)
+{
+	for (NodeHandle nodeIt = 0; nodeIt < m_graph.size(); ++nodeIt)
+	{
+		m_initialDebt += std::max(-m_initialValues[nodeIt], 0);
+		m_maxDegree = std::max(m_maxDegree, (uint32_t)m_graph.getNodeConnections(nodeIt).size());
+	}
+}
+
+void OptimalSearch::push(size_t queueIndex, SearchTask&& task)
+{
+	m_pendingTasks.fetch_add(1);
+
+	TaskQueue& queue = m_queues[queueIndex];
+	std::lock_guard<std::mutex> lock(queue.mutex);
+	queue.tasks.push_back(std::move(task));
+}
+
+bool OptimalSearch::tryPop(size_t queueIndex, SearchTask& outTask)
+{
+	{
+		TaskQueue& queue = m_queues[queueIndex];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.tasks.empty())
+		{
+			outTask = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+			return true;
+		}
+	}
+
+	for (size_t offset = 1; offset < m_queues.size(); ++offset)
+	{
+		TaskQueue& queue = m_queues[(queueIndex + offset) % m_queues.size()];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.tasks.empty())
+		{
+			outTask = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void OptimalSearch::wakeIdleWorkers()
+{
+	std::lock_guard<std::mutex> lock(m_idleMutex);
+	m_wakeCount.fetch_add(1);
+	m_idleCondition.notify_all();
+}
+
+bool OptimalSearch::runIteration()
+{
+	SOLVER_TRACE_SCOPE(m_ctx, "iteration");
+
+	++m_iteration;
+	m_nextThreshold.store(NoThreshold);
+	m_idleWorkers.store(m_queues.size());
+	push(0, SearchTask());
+
+	if (m_ctx.threadPool())
+	{
+		m_ctx.threadPool()->run(m_queues.size(), [this] (size_t workerIt) {
+			SearchWorker(*this, workerIt).run();
+		});
+	}
+	else
+	{
+		SearchWorker(*this, 0).run();
+	}
+
+	// Cancelled workers can leave tasks behind.
+	for (auto& queue : m_queues)
+	{
+		queue.tasks.clear();
+	}
+	m_pendingTasks.store(0);
+
+	return m_solved.load();
+}
+
+bool OptimalSearch::run()
+{
+	if (m_initialDebt == 0)
+	{
+		return true;
+	}
+
+	m_threshold = lowerBound(m_initialDebt);
+	while (!runIteration())
+	{
+		if (m_ctx.wasStopped())
+		{
+			return false;
+		}
+
+		m_threshold = m_nextThreshold.load();
+		if (m_threshold == NoThreshold || m_threshold > m_ctx.moveLimit())
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+SearchWorker::SearchWorker(OptimalSearch& search, size_t index)
+	: m_search(search)
+	, m_index(index)
+	, m_hash(0)
+	, m_debt(0)
+	, m_nextThreshold(NoThreshold)
+	, m_nodeCount(0)
+	, m_aborted(false)
+{
+}
+
+bool SearchWorker::poll()
+{
+	if ((++m_nodeCount % PollInterval) == 0)
+	{
+		m_aborted = m_search.m_solved.load(std::memory_order_relaxed) || m_search.m_ctx.wasStopped();
+	}
+	return !m_aborted;
+}
+
+// Returns true if a solution was found below the current state.
+bool SearchWorker::search()
+{
+	if (!poll())
+	{
+		return false;
+	}
+
+	if (m_debt == 0)
+	{
+		if (!m_search.m_solved.exchange(true))
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_search.m_solutionMutex);
+				m_search.m_solution = m_path;
+			}
+			m_search.wakeIdleWorkers();
+		}
+		return true;
+	}
+
+	const uint32_t depth = (uint32_t)m_path.size();
+	const uint32_t bound = depth + m_search.lowerBound(m_debt);
+	if (bound > m_search.m_threshold)
+	{
+		m_nextThreshold = std::min(m_nextThreshold, bound);
+		return false;
+	}
+
+	if (!m_search.m_transpositions.visit(m_hash, m_search.m_iteration, depth))
+	{
+		return false;
+	}
+
+	const bool split = m_search.m_threshold - depth >= MinSplitBudget && m_search.m_idleWorkers.load(std::memory_order_relaxed) > 0;
+
+	const NodeHandle nodeCount = (NodeHandle)m_values.size();
+	for (NodeHandle node = 0; node < nodeCount; ++node)
+	{
+		for (const Move::Type type : { Move::Take, Move::Give })
+		{
+			// A give directly followed by a take on the same node cancels out.
+			if (!m_path.empty() && m_path.back().node == node && m_path.back().type != type)
+			{
+				continue;
+			}
+
+			m_path.emplace_back(type, node);
+			if (split)
+			{
+				m_search.push(m_index, SearchTask{ m_path });
+			}
+			else
+			{
+				apply(type, node);
+				const bool found = search();
+				undo(type, node);
+				if (found)
+				{
+					return true;
+				}
+			}
+			m_path.pop_back();
+		}
+	}
+
+	if (split)
+	{
+		m_search.wakeIdleWorkers();
+	}
+	return false;
+}
+
+void SearchWorker::run()
+{
+	SearchTask task;
+	while (!m_search.m_solved.load(std::memory_order_relaxed) && !m_search.m_ctx.wasStopped())
+	{
+		// Read before looking for a task, so that a task pushed after the lookup wakes
+		// this worker up.
+		const uint64_t wakeCount = m_search.m_wakeCount.load();
+		if (!m_search.tryPop(m_index, task))
+		{
+			if (m_search.m_pendingTasks.load() == 0)
+			{
+				break;
+			}
+
+			std::unique_lock<std::mutex> lock(m_search.m_idleMutex);
+			m_search.m_idleCondition.wait_for(lock, IdleWaitTime, [this, wakeCount] {
+				return m_search.m_wakeCount.load() != wakeCount;
+			});
+			continue;
+		}
+
+		m_search.m_idleWorkers.fetch_sub(1);
+
+		m_values = m_search.m_initialValues;
+		m_hash = m_search.m_initialHash;
+		m_debt = m_search.m_initialDebt;
+		for (const Move& move : task.moves)
+		{
+			apply(move.type, move.node);
+		}
+		m_path = std::move(task.moves);
+
+		search();
+
+		m_search.m_idleWorkers.fetch_add(1);
+		if (m_search.m_pendingTasks.fetch_sub(1) == 1)
+		{
+			m_search.wakeIdleWorkers();
+		}
+	}
+
+	// Fold this worker's exceeded bounds into the next threshold.
+	uint32_t nextThreshold = m_search.m_nextThreshold.load();
+	while (m_nextThreshold < nextThreshold && !m_search.m_nextThreshold.compare_exchange_weak(nextThreshold, m_nextThreshold))
+	{
+	}
+}
+
+SOLVER_FUNC(SolverContext& ctx)
+{
+	OptimalSearch search(ctx);
+	if (!search.run())
+	{
+		ctx.stop();
+		return;
+	}
+
+	for (const Move& move : search.solution())
+	{
+		ctx.registerMove(move);
+	}
+}
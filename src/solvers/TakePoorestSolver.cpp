@@ -3,17 +3,24 @@
 SOLVER_NAME("TakePoorest")
 SOLVER_DESCRIPTION("Finds the poorest node and takes from its neighbors.")
 
-static NodeHandle getPoorestNode(const Graph& graph)
+// The graph is unsolved, so the poorest node is one of the debtors. Ties go to the lowest
+// handle, as the debtors are in no particular order.
+static NodeHandle getPoorestNode(const SolverContext& ctx)
 {
-	const auto minIt = std::min_element(graph.values().cbegin(), graph.values().cend());
-	return (NodeHandle)std::distance(graph.values().cbegin(), minIt);
+	const auto debtors = ctx.debtors();
+	const auto minIt = std::min_element(debtors.begin(), debtors.end(), [&ctx] (NodeHandle a, NodeHandle b) {
+		const NodeValue valueA = ctx.graph().getNodeValue(a);
+		const NodeValue valueB = ctx.graph().getNodeValue(b);
+		return valueA < valueB || (valueA == valueB && a < b);
+	});
+	return *minIt;
 }
 
 SOLVER_FUNC(SolverContext& ctx)
 {
 	while (!ctx.isSolved())
 	{
-		const NodeHandle poorestNode = getPoorestNode(ctx.graph());
+		const NodeHandle poorestNode = getPoorestNode(ctx);
 		ctx.registerMove<Move::Take>(poorestNode);
 	}
 }